@@ -0,0 +1,58 @@
+#include "libsim.h"
+#include "sim_sweep.h"
+
+/*  Simulator: one embeddable simulation run, see libsim.h
+*/
+
+void Push_Trace_Reader::push(const trace_record *records, size_t n){
+    //drop what Fetch has consumed, then append behind what it hasn't
+    size_t unread = end - cur;
+    if(unread != 0 && cur != &buf[0]){
+        memmove(&buf[0], cur, unread * sizeof(trace_record));
+    }
+    buf.resize(unread);
+    buf.insert(buf.end(), records, records + n);
+    cur = buf.empty() ? NULL : &buf[0];
+    end = cur + buf.size();
+}
+
+Simulator::Simulator(const proc_params &params, const Op_Table &ops) : sim(params), completed(false){
+    sim.ops = ops;
+    core = Select_Core(sim);
+    //a bundle that can never dispatch would keep run_to_completion() from returning
+    runnable = params.width != 0 && runnable_config(params);
+    completed = !runnable;
+}
+
+Simulator::~Simulator(){
+}
+
+void Simulator::push(const trace_record *records, size_t n){
+    input.push(records, n);
+}
+
+uint64_t Simulator::step(uint64_t n_cycles){
+    uint64_t start = sim.num_cycles;
+    //Fetch takes up to WIDTH instr. a cycle, a shorter run of them would read as the end of the trace
+    while(!completed && (uint64_t)sim.num_cycles - start < n_cycles
+            && (input.finished || input.available() >= sim.params.width)){
+        completed = !core(sim, input);
+    }
+    return sim.num_cycles - start;
+}
+
+void Simulator::run_to_completion(){
+    finish();
+    while(!completed){
+        completed = !core(sim, input);
+    }
+}
+
+simulator_stats Simulator::stats() const {
+    simulator_stats st;
+    st.num_instr = sim.num_instr;
+    st.num_retired = sim.seq;
+    st.num_cycles = sim.num_cycles;
+    st.ipc = (sim.num_cycles != 0) ? double(sim.num_instr) / double(sim.num_cycles) : 0;
+    return st;
+}
@@ -0,0 +1,91 @@
+#ifndef LIBSIM_H
+#define LIBSIM_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "sim_proc.h"
+
+//Embedding API---------------------------------------------------------------------------------------------------------
+//
+//libsim.a runs the simulator inside another program: a Simulator holds one run's whole state,
+//instr. are pushed to it in memory in batches of any size, and it is advanced a number of cycles
+//at a time. Simulators are independent, any number can live (and run on separate threads) in
+//one process.
+//
+//    Simulator sim(params);
+//    if(!sim.ok()){ ... }            //WIDTH 0, or an IQ or ROB smaller than WIDTH
+//    while(more_instructions){
+//        sim.push(batch.data(), batch.size());
+//        sim.step(100000);           //stops early when it has run out of pushed instr.
+//    }
+//    sim.run_to_completion();        //no more instr.: drain the pipeline
+//    simulator_stats st = sim.stats();
+//
+//the result is the same as sim on a trace of the same instr. in the same order: a cycle is only
+//simulated once WIDTH instr. are buffered (or the input is finished), so Fetch always sees what it
+//would have read from the trace file
+
+typedef struct simulator_stats{
+    uint64_t num_instr;         //fetched
+    uint64_t num_retired;
+    uint64_t num_cycles;
+    double ipc;                 //num_instr / num_cycles, once the run has completed
+}simulator_stats;
+
+//instr. pushed but not yet fetched, read by Fetch through the Trace_Reader interface;
+//[cur, end) always spans every buffered instr., so there is never more to refill()
+class Push_Trace_Reader : public Trace_Reader{
+public:
+    std::vector<trace_record> buf;
+    bool finished;              //no more instr. will be pushed
+    Push_Trace_Reader() : finished(false){}
+    void push(const trace_record *records, size_t n);
+    size_t available() const { return end - cur; }
+    bool refill(){ return false; }
+};
+
+class Simulator{
+public:
+    Simulator(const proc_params &params, const Op_Table &ops = Op_Table());
+    ~Simulator();
+
+    //false if params could never dispatch a bundle (see runnable_config); such a simulator is done
+    //from the start and simulates nothing
+    bool ok() const { return runnable; }
+
+    //append instr. to the input, in program order
+    void push(const trace_record *records, size_t n);
+    void push(const std::vector<trace_record> &records){
+        if(!records.empty()){
+            push(&records[0], records.size());
+        }
+    }
+    //no more instr. will be pushed, the run completes once the pipeline drains
+    void finish(){ input.finished = true; }
+
+    //simulate n_cycles cycles, returns the number simulated: fewer if the pushed instr. ran out before
+    //finish() or the run completed, a few more if the event clock's last jump crossed n_cycles
+    uint64_t step(uint64_t n_cycles);
+    //finish() and simulate until the pipeline drains
+    void run_to_completion();
+    bool done() const { return completed; }
+
+    //per-instruction timing output (see timing_log.h) and stall/occupancy counters, NULL for none
+    void set_timing_output(Timing_Writer *writer){ sim.timing_out = writer; }
+    void set_stall_stats(Sim_Stats *stats){ sim.stats = stats; }
+
+    simulator_stats stats() const;
+    const Sim_State &state() const { return sim; }
+
+private:
+    Sim_State sim;
+    Push_Trace_Reader input;
+    step_fn core;
+    bool runnable;
+    bool completed;
+    Simulator(const Simulator &);
+    Simulator &operator=(const Simulator &);
+};
+
+#endif
@@ -0,0 +1,221 @@
+#include <cstdio>
+#include <cstdlib>
+#include <climits>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "timing_log.h"
+
+/*  Renders the pipeline diagram ("scope" view) for part of a binary timing log written by
+    sim --timing=binary --out=<log>. The <log>.idx seek index is used to start decoding at the
+    nearest seek point, so a window near the end of a long run doesn't re-read the prefix.
+
+    Example:-
+    scope gcc.tlog --seq=5000:5100      instr. 5000 through 5100
+    scope gcc.tlog --cycle=9000:9200    instr. in flight during cycles 9000 through 9200
+    scope gcc.tlog --seq=0:99 --text    the same records as sim's text timing output
+
+    Without a window the whole log is rendered.
+*/
+
+#define PAGE_ROWS   35
+
+//read-only mapping of a whole file
+class Mapped_File{
+public:
+    const char *data;
+    size_t len;
+    Mapped_File() : data(NULL), len(0){}
+    ~Mapped_File(){
+        if(data != NULL){
+            munmap((void *)data, len);
+        }
+    }
+    bool open(const char *name){
+        int fd = ::open(name, O_RDONLY);
+        struct stat st;
+        if(fd < 0){
+            return false;
+        }
+        if(fstat(fd, &st) != 0 || st.st_size == 0){
+            close(fd);
+            return false;
+        }
+        void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if(map == MAP_FAILED){
+            return false;
+        }
+        data = (const char *)map;
+        len = st.st_size;
+        return true;
+    }
+};
+
+//one page of the diagram: a cycle-number header, then a row per instr.
+void Print_Page(const std::vector<timing_record> &rows, long start, long end){
+    long last = 0;
+    for(size_t i = 0; i < rows.size(); i++){
+        long rt_end = rows[i].begin[STAGE_RT] + rows[i].cycles[STAGE_RT] - 1;
+        if(rt_end > last){
+            last = rt_end;
+        }
+    }
+    if(last > end){
+        last = end;
+    }
+    int digits = 4;
+    for(long c = last; c >= 10000; c /= 10){
+        digits++;
+    }
+    std::string line;
+    for(int d = digits - 1; d >= 0; d--){
+        long div = 1;
+        for(int k = 0; k < d; k++){
+            div *= 10;
+        }
+        line.assign(36, ' ');
+        line += '\t';
+        for(long c = start; c <= last; c++){
+            line += (char)('0' + (c / div) % 10);
+            line += "  ";
+        }
+        printf("%s\n", line.c_str());
+    }
+    for(size_t i = 0; i < rows.size(); i++){
+        const timing_record &rec = rows[i];
+        printf("%8llu fu{%d} src{%3d,%3d} dst{%3d}\t", (unsigned long long)rec.seq, rec.op_type, rec.src1, rec.src2, rec.dst);
+        line.clear();
+        for(long c = start; c < rec.begin[STAGE_FE] && c <= last; c++){
+            line += "   ";
+        }
+        for(int s = 0; s < NUM_STAGES; s++){
+            for(long c = rec.begin[s]; c < rec.begin[s] + rec.cycles[s]; c++){
+                if(c >= start && c <= last){
+                    line += STAGE_NAMES[s];
+                    line += ' ';
+                }
+            }
+        }
+        printf("%s\n", line.c_str());
+    }
+}
+
+int main (int argc, char* argv[])
+{
+    const char *log_file = NULL;
+    bool by_cycle = false, text = false;
+    long lo = 0, hi = -1;       //window, hi < 0 for no upper bound
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "--seq=", 6) == 0 || strncmp(argv[i], "--cycle=", 8) == 0)
+        {
+            by_cycle = (argv[i][2] == 'c');
+            char *p = strchr(argv[i], '=') + 1, *q;
+            lo = strtol(p, &q, 10);
+            hi = (*q == ':') ? strtol(q + 1, NULL, 10) : lo;
+        }
+        else if (strcmp(argv[i], "--text") == 0)
+            text = true;
+        else if (log_file == NULL && argv[i][0] != '-')
+            log_file = argv[i];
+        else
+        {
+            printf("Error: Unknown option %s\n", argv[i]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (log_file == NULL)
+    {
+        printf("Usage: %s <timing log> [--seq=A:B | --cycle=A:B] [--text]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    Mapped_File log, index;
+    if (!log.open(log_file) || log.len < sizeof(timing_log_header)
+            || memcmp(log.data, TIMING_MAGIC, TIMING_MAGIC_LEN) != 0)
+    {
+        printf("Error: %s is not a binary timing log\n", log_file);
+        exit(EXIT_FAILURE);
+    }
+
+    //start from the last seek point wholly before the window, or the top of the log without an index
+    std::string index_file = std::string(log_file) + ".idx";
+    uint64_t seq = 0, offset = sizeof(timing_log_header);
+    long prev_fetch = 0;
+    if (index.open(index_file.c_str()) && index.len >= sizeof(timing_log_header)
+            && memcmp(index.data, TIMING_INDEX_MAGIC, TIMING_MAGIC_LEN) == 0)
+    {
+        const timing_seek_point *sp = (const timing_seek_point *)(index.data + sizeof(timing_log_header));
+        size_t n = (index.len - sizeof(timing_log_header)) / sizeof(timing_seek_point);
+        size_t first = 0, last = n;
+        //first seek point past the window start
+        while (first < last)
+        {
+            size_t mid = (first + last) / 2;
+            if (by_cycle ? (sp[mid].retire < lo) : ((long)sp[mid].seq <= lo))
+                first = mid + 1;
+            else
+                last = mid;
+        }
+        if (first != 0)
+        {
+            seq = sp[first - 1].seq;
+            offset = sp[first - 1].offset;
+            prev_fetch = sp[first - 1].prev_fetch;
+        }
+    }
+
+    const char *p = log.data + offset, *e = log.data + log.len;
+    std::vector<timing_record> page;
+    long page_start = -1;
+    timing_record rec;
+    while (p < e)
+    {
+        if ((p = get_timing_record(p, e, seq, prev_fetch, rec)) == NULL)
+        {
+            printf("Error: %s is truncated\n", log_file);
+            exit(EXIT_FAILURE);
+        }
+        long rt_end = rec.begin[STAGE_RT] + rec.cycles[STAGE_RT] - 1;
+        bool before = by_cycle ? (rt_end < lo) : ((long)seq < lo);
+        bool after = hi >= 0 && (by_cycle ? (rec.begin[STAGE_FE] > hi) : ((long)seq > hi));
+        if (after)
+            break;
+        if (!before)
+        {
+            if (text)
+            {
+                printf("%llu fu{%d} src{%d,%d} dst{%d}", (unsigned long long)rec.seq, rec.op_type, rec.src1, rec.src2, rec.dst);
+                for (int s = 0; s < NUM_STAGES; s++)
+                    printf(" %s{%lld,%d}", STAGE_NAMES[s], (long long)rec.begin[s], rec.cycles[s]);
+                printf("\n");
+            }
+            else
+            {
+                //a page starts where the previous page's last instr. was fetched
+                if (page_start < 0)
+                    page_start = (seq == 0) ? rec.begin[STAGE_FE] : prev_fetch;
+                page.push_back(rec);
+                if (page.size() == PAGE_ROWS)
+                {
+                    Print_Page(page, (by_cycle && page_start < lo) ? lo : page_start, (by_cycle && hi >= 0) ? hi : LONG_MAX);
+                    page_start = rec.begin[STAGE_FE];
+                    page.clear();
+                }
+            }
+        }
+        prev_fetch = rec.begin[STAGE_FE];
+        seq++;
+    }
+    if (!page.empty())
+        Print_Page(page, (by_cycle && page_start < lo) ? lo : page_start, (by_cycle && hi >= 0) ? hi : LONG_MAX);
+
+    return 0;
+}
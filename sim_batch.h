@@ -0,0 +1,213 @@
+#ifndef SIM_BATCH_H
+#define SIM_BATCH_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "sim_proc.h"
+#include "sim_sweep.h"
+
+//Batched Sweep---------------------------------------------------------------------------------------------------------
+//
+//./sim --sweep --batch [--jobs=N] <rob_sizes> <iq_sizes> <widths> <trace_file>
+//
+//every configuration of the sweep is simulated in a single streaming pass over the trace instead
+//of each one walking a fully decoded copy of it. the trace is decoded a block of BATCH_BLOCK
+//records at a time into a window all configurations share; each runs until its next bundle
+//would cross the end of the window, then the window drops what every configuration has fetched
+//and takes the next block. so the block is read from memory once and from cache by every other
+//configuration, and memory stays at about two blocks plus the per-configuration state, however
+//long the trace (a text or compressed trace is never decoded whole)
+//
+//a configuration only steps while a whole bundle is left in the window (or the trace has ended),
+//so Fetch sees exactly the records it would in a separate run, and the summaries match ./sim's.
+//N threads (default: all cores) are started once for the whole pass; for each block they take
+//configurations off a shared counter, and the window only moves once all of them are done
+//
+//each configuration is a separate Sim_State stepped by the usual stage functions, the batch
+//itself only tracks where in the trace each one is and whether it has finished
+
+#define BATCH_BLOCK     65536       //records decoded per block (1MB, about an L2)
+
+//one configuration's view of the shared window, re-pointed whenever the window moves
+class Batch_Trace_Reader : public Trace_Reader{
+public:
+    Batch_Trace_Reader(){
+        cur = end = NULL;
+    }
+    bool refill(){ return false; }
+};
+
+class Batch_Sweep{
+public:
+    Trace_Reader &source;
+    const std::vector<proc_params> &configs;
+    std::vector<trace_record> window;
+    uint64_t window_base;                   //trace position of window[0]
+    bool source_done;
+    std::vector<Sim_State *> states;
+    std::vector<step_fn> steps;
+    std::vector<Batch_Trace_Reader> readers;
+    std::vector<uint64_t> next_rec;         //trace position of each configuration's next record
+    std::vector<unsigned char> running;
+    //worker pool, woken once per block
+    std::mutex lock;
+    std::condition_variable start, done;
+    unsigned long block;                    //blocks handed to the workers so far
+    unsigned busy;                          //workers still on the current block
+    bool finished;
+    std::atomic<size_t> next_config;
+
+    Batch_Sweep(Trace_Reader &trace, const std::vector<proc_params> &c, const Op_Table &ops)
+            : source(trace), configs(c), window_base(0), source_done(false), readers(c.size()), next_rec(c.size(), 0),
+            running(c.size(), 1), block(0), busy(0), finished(false), next_config(0){
+        for(size_t i = 0; i < configs.size(); i++){
+            Sim_State *sim = new Sim_State(configs[i]);
+            sim->timing_out = NULL;
+            sim->ops = ops;
+            states.push_back(sim);
+            steps.push_back(Select_Core(*sim));
+        }
+        window.reserve(2 * BATCH_BLOCK);
+    }
+    ~Batch_Sweep(){
+        for(size_t i = 0; i < states.size(); i++){
+            delete states[i];
+        }
+    }
+
+    //drop the records every configuration has fetched, append the next block
+    void slide(){
+        uint64_t lo = window_base + window.size();
+        for(size_t i = 0; i < configs.size(); i++){
+            if(running[i] && next_rec[i] < lo){
+                lo = next_rec[i];
+            }
+        }
+        window.erase(window.begin(), window.begin() + (lo - window_base));
+        window_base = lo;
+        size_t want = window.size() + BATCH_BLOCK;
+        while(window.size() < want && !source_done){
+            if(source.cur == source.end && !source.refill()){
+                source_done = true;
+                break;
+            }
+            size_t n = source.end - source.cur;
+            if(n > want - window.size()){
+                n = want - window.size();
+            }
+            window.insert(window.end(), source.cur, source.cur + n);
+            source.cur += n;
+        }
+        //a finished configuration's position can be behind the window, it isn't read again
+        for(size_t i = 0; i < configs.size(); i++){
+            if(running[i]){
+                readers[i].cur = window.data() + (next_rec[i] - window_base);
+                readers[i].end = window.data() + window.size();
+            }
+        }
+    }
+
+    //step configuration i until its next bundle could run past the window
+    void advance(size_t i){
+        if(!running[i]){
+            return;
+        }
+        Sim_State &sim = *states[i];
+        Batch_Trace_Reader &trace = readers[i];
+        step_fn step = steps[i];
+        const trace_record *base = window.data();
+        bool go = true;
+        while(go && (source_done || (unsigned long)(trace.end - trace.cur) >= sim.params.width)){
+            go = step(sim, trace);
+        }
+        running[i] = go;
+        next_rec[i] = window_base + (trace.cur - base);
+    }
+
+    //advance the configurations of the current block not yet taken by another thread
+    void share_block(){
+        for(size_t i = next_config++; i < configs.size(); i = next_config++){
+            advance(i);
+        }
+    }
+
+    void worker(){
+        unsigned long seen = 0;
+        while(true){
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                start.wait(guard, [&](){ return block != seen || finished; });
+                if(finished){
+                    return;
+                }
+                seen = block;
+            }
+            share_block();
+            std::lock_guard<std::mutex> guard(lock);
+            if(--busy == 0){
+                done.notify_one();
+            }
+        }
+    }
+
+    void run(unsigned jobs, std::vector<sweep_result> &results){
+        if(jobs == 0){
+            jobs = std::thread::hardware_concurrency();
+        }
+        if(jobs == 0 || jobs > configs.size()){
+            jobs = configs.size();
+        }
+        //the calling thread works on every block too
+        std::vector<std::thread> workers;
+        for(unsigned t = 1; t < jobs; t++){
+            workers.push_back(std::thread(&Batch_Sweep::worker, this));
+        }
+        bool any = !configs.empty();
+        while(any){
+            slide();
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                next_config = 0;
+                busy = workers.size();
+                block++;
+            }
+            start.notify_all();
+            share_block();
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                done.wait(guard, [&](){ return busy == 0; });
+            }
+            any = false;
+            for(size_t i = 0; i < configs.size(); i++){
+                any = any || running[i];
+            }
+        }
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            finished = true;
+        }
+        start.notify_all();
+        for(unsigned t = 0; t < workers.size(); t++){
+            workers[t].join();
+        }
+        results.resize(configs.size());
+        for(size_t i = 0; i < configs.size(); i++){
+            results[i].params = configs[i];
+            results[i].num_instr = states[i]->num_instr;
+            results[i].num_cycles = states[i]->num_cycles;
+        }
+    }
+};
+
+//simulate every config in one pass over trace on jobs threads, results[i] belongs to configs[i]
+inline void Run_Batch(Trace_Reader &trace, const std::vector<proc_params> &configs, const Op_Table &ops, unsigned jobs,
+        std::vector<sweep_result> &results){
+    Batch_Sweep batch(trace, configs, ops);
+    batch.run(jobs, results);
+}
+
+#endif
@@ -0,0 +1,205 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/*  Simulator throughput benchmark: runs sim (summary only) on one trace for a fixed matrix of
+    ROB_SIZE/IQ_SIZE/WIDTH configurations, one process per configuration, and reports simulated
+    instructions per host second and the peak RSS of each run.
+
+    Example:-
+    sim_bench bench.bin
+    sim_bench --out=bench.csv --baseline=old.csv --sim=./sim bench.bin
+
+    --out=FILE        also write the results as CSV (one row per configuration, fixed column order)
+    --baseline=FILE   CSV from an earlier build, each row is compared against it
+    --sim=PATH        simulator binary (default ./sim)
+    --runs=N          best of N runs per configuration (default 1)
+*/
+
+typedef struct bench_config{
+    unsigned long rob_size, iq_size, width;
+}bench_config;
+
+//the matrix, small/stall-heavy machines through wide ones
+static const bench_config BENCH_MATRIX[] = {
+    {16, 8, 1}, {32, 8, 2}, {64, 16, 4}, {128, 32, 4}, {256, 32, 4}, {256, 64, 8}, {512, 64, 8}, {1024, 128, 8}
+};
+#define BENCH_CONFIGS (sizeof(BENCH_MATRIX) / sizeof(BENCH_MATRIX[0]))
+
+typedef struct bench_result{
+    bench_config cfg;
+    unsigned long long num_instr, num_cycles;
+    double seconds;
+    long peak_rss_kb;
+}bench_result;
+
+#define CSV_HEADER "rob_size,iq_size,width,instructions,cycles,seconds,instr_per_sec,peak_rss_kb"
+
+//run sim once, returns false if it failed
+bool Run_Sim(const char *sim, const char *trace, const bench_config &cfg, bench_result &res)
+{
+    char rob[32], iq[32], width[32];
+    snprintf(rob, sizeof(rob), "%lu", cfg.rob_size);
+    snprintf(iq, sizeof(iq), "%lu", cfg.iq_size);
+    snprintf(width, sizeof(width), "%lu", cfg.width);
+    int fds[2];
+    if (pipe(fds) != 0)
+        return false;
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        dup2(fds[1], STDOUT_FILENO);
+        close(fds[0]);
+        close(fds[1]);
+        execl(sim, sim, "--timing=none", rob, iq, width, trace, (char *)NULL);
+        _exit(127);
+    }
+    close(fds[1]);
+    if (pid < 0)
+    {
+        close(fds[0]);
+        return false;
+    }
+
+    //the summary is a few lines, parse the counts out of it
+    std::string out;
+    char buf[4096];
+    ssize_t n;
+    while ((n = read(fds[0], buf, sizeof(buf))) > 0)
+        out.append(buf, n);
+    close(fds[0]);
+    int status;
+    struct rusage ru;
+    if (wait4(pid, &status, 0, &ru) != pid)
+        return false;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    const char *instr = strstr(out.c_str(), "Dynamic Instruction Count");
+    const char *cycles = strstr(out.c_str(), "# Cycles");
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 || instr == NULL || cycles == NULL)
+    {
+        fputs(out.c_str(), stderr);
+        return false;
+    }
+    res.cfg = cfg;
+    res.num_instr = strtoull(strchr(instr, '=') + 1, NULL, 10);
+    res.num_cycles = strtoull(strchr(cycles, '=') + 1, NULL, 10);
+    res.seconds = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1e-9;
+    res.peak_rss_kb = ru.ru_maxrss;
+    return true;
+}
+
+int main (int argc, char* argv[])
+{
+    const char *sim = "./sim", *out_file = NULL, *baseline_file = NULL;
+    int runs = 1;
+    int argi = 1;
+
+    while (argi < argc && strncmp(argv[argi], "--", 2) == 0)
+    {
+        if (strncmp(argv[argi], "--out=", 6) == 0)
+            out_file = argv[argi] + 6;
+        else if (strncmp(argv[argi], "--baseline=", 11) == 0)
+            baseline_file = argv[argi] + 11;
+        else if (strncmp(argv[argi], "--sim=", 6) == 0)
+            sim = argv[argi] + 6;
+        else if (strncmp(argv[argi], "--runs=", 7) == 0)
+            runs = atoi(argv[argi] + 7);
+        else
+        {
+            printf("Error: Unknown option %s\n", argv[argi]);
+            exit(EXIT_FAILURE);
+        }
+        argi++;
+    }
+    if (argc - argi != 1 || runs < 1)
+    {
+        printf("Error: Wrong number of inputs:%d\n", argc-argi);
+        printf("Usage: %s [--out=FILE] [--baseline=FILE] [--sim=PATH] [--runs=N] <trace>\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    const char *trace = argv[argi];
+
+    //baseline rows, matched to the matrix by configuration
+    std::vector<bench_result> baseline;
+    if (baseline_file != NULL)
+    {
+        FILE *fp = fopen(baseline_file, "r");
+        if (fp == NULL)
+        {
+            printf("Error: Unable to open file %s\n", baseline_file);
+            exit(EXIT_FAILURE);
+        }
+        char line[512];
+        bench_result r;
+        while (fgets(line, sizeof(line), fp) != NULL)
+            if (sscanf(line, "%lu,%lu,%lu,%llu,%llu,%lf,%*f,%ld", &r.cfg.rob_size, &r.cfg.iq_size, &r.cfg.width,
+                    &r.num_instr, &r.num_cycles, &r.seconds, &r.peak_rss_kb) == 7)
+                baseline.push_back(r);
+        fclose(fp);
+    }
+
+    FILE *csv = NULL;
+    if (out_file != NULL && (csv = fopen(out_file, "w")) == NULL)
+    {
+        printf("Error: Unable to open file %s\n", out_file);
+        exit(EXIT_FAILURE);
+    }
+    if (csv != NULL)
+        fprintf(csv, "%s\n", CSV_HEADER);
+
+    printf("# %s on %s\n", sim, trace);
+    printf("# %-16s %12s %12s %9s %14s %12s%s\n", "ROB/IQ/WIDTH", "instr", "cycles", "seconds", "instr/sec",
+            "peak RSS kB", baseline.empty() ? "" : "   vs baseline");
+    for (size_t i = 0; i < BENCH_CONFIGS; i++)
+    {
+        bench_result best, res;
+        for (int r = 0; r < runs; r++)
+        {
+            if (!Run_Sim(sim, trace, BENCH_MATRIX[i], res))
+            {
+                printf("Error: %s %lu %lu %lu %s failed\n", sim, BENCH_MATRIX[i].rob_size, BENCH_MATRIX[i].iq_size,
+                        BENCH_MATRIX[i].width, trace);
+                exit(EXIT_FAILURE);
+            }
+            if (r == 0 || res.seconds < best.seconds)
+                best = res;
+        }
+        char name[64];
+        snprintf(name, sizeof(name), "%lu/%lu/%lu", best.cfg.rob_size, best.cfg.iq_size, best.cfg.width);
+        double rate = best.num_instr / best.seconds;
+        printf("  %-16s %12llu %12llu %9.3f %14.0f %12ld", name, best.num_instr, best.num_cycles, best.seconds, rate,
+                best.peak_rss_kb);
+        for (size_t b = 0; b < baseline.size(); b++)
+        {
+            const bench_result &base = baseline[b];
+            if (base.cfg.rob_size != best.cfg.rob_size || base.cfg.iq_size != best.cfg.iq_size
+                    || base.cfg.width != best.cfg.width)
+                continue;
+            printf("   %5.2fx", base.seconds / best.seconds);
+            if (base.num_instr != best.num_instr || base.num_cycles != best.num_cycles)
+                printf(" (cycles differ: %llu)", base.num_cycles);
+            break;
+        }
+        printf("\n");
+        if (csv != NULL)
+            fprintf(csv, "%lu,%lu,%lu,%llu,%llu,%.6f,%.0f,%ld\n", best.cfg.rob_size, best.cfg.iq_size, best.cfg.width,
+                    best.num_instr, best.num_cycles, best.seconds, rate, best.peak_rss_kb);
+    }
+    if (csv != NULL && fclose(csv) != 0)
+    {
+        printf("Error: Unable to write file %s\n", out_file);
+        exit(EXIT_FAILURE);
+    }
+
+    return 0;
+}
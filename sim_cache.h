@@ -0,0 +1,325 @@
+#ifndef SIM_CACHE_H
+#define SIM_CACHE_H
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "sim_proc.h"
+
+//Result Cache----------------------------------------------------------------------------------------------------------
+//
+//./sim --cache=DIR <rob_size> <iq_size> <width> <trace_file>      (also with --sweep)
+//
+//a run is identified by a 64-bit hash of
+//  the trace file's contents         (so a renamed or copied trace still hits)
+//  the sim binary's contents         (any rebuild starts afresh)
+//  ROB_SIZE, IQ_SIZE, WIDTH and the --fu-config op classes
+//DIR/<key>.sum holds the summary counts of the run and the full key, which is compared on
+//lookup so a hash collision is a miss. a run with per-instruction timing also stores its
+//binary timing log, DIR/<key>.tlog and .tlog.idx; a hit copies it to --out, or decodes it back
+//into text timing, instead of simulating. --clock doesn't change results and isn't part of the key
+//
+//hashing a multi-GB trace on every run would cost more than some simulations, so
+//DIR/stat/<dev>-<inode> remembers a file's hash along with its size, mtime and ctime; the file
+//is only read again once one of those changes
+//
+//many sim processes can share DIR: every file is written under a per-process temporary name and
+//rename()d into place, so a reader sees a whole file or none. the log goes in before the .sum, so
+//a .sum never announces a log that is half written. two processes missing on the same key at
+//once both simulate and store identical files, the second rename wins
+
+#define CACHE_MAGIC     "SIMCACHE"
+#define CACHE_MAGIC_LEN 8
+#define CACHE_VERSION   1
+#define CACHE_CHUNK     (1 << 20)   //bytes hashed at a time
+
+//xxHash64 (Yann Collet), one pass over a buffer
+static const uint64_t XXH_P1 = 0x9E3779B185EBCA87ULL, XXH_P2 = 0xC2B2AE3D27D4EB4FULL, XXH_P3 = 0x165667B19E3779F9ULL,
+                      XXH_P4 = 0x85EBCA77C2B2AE63ULL, XXH_P5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t xxh_rotl(uint64_t x, int r){ return (x << r) | (x >> (64 - r)); }
+inline uint64_t xxh_round(uint64_t acc, uint64_t in){ return xxh_rotl(acc + in * XXH_P2, 31) * XXH_P1; }
+inline uint64_t xxh_merge(uint64_t acc, uint64_t v){ return (acc ^ xxh_round(0, v)) * XXH_P1 + XXH_P4; }
+inline uint64_t xxh_read64(const uint8_t *p){ uint64_t v; memcpy(&v, p, 8); return v; }
+inline uint32_t xxh_read32(const uint8_t *p){ uint32_t v; memcpy(&v, p, 4); return v; }
+
+inline uint64_t hash_bytes(const void *data, size_t len, uint64_t seed){
+    const uint8_t *p = (const uint8_t *)data, *e = p + len;
+    uint64_t h;
+    if(len >= 32){
+        uint64_t v1 = seed + XXH_P1 + XXH_P2, v2 = seed + XXH_P2, v3 = seed, v4 = seed - XXH_P1;
+        for(; p + 32 <= e; p += 32){
+            v1 = xxh_round(v1, xxh_read64(p));
+            v2 = xxh_round(v2, xxh_read64(p + 8));
+            v3 = xxh_round(v3, xxh_read64(p + 16));
+            v4 = xxh_round(v4, xxh_read64(p + 24));
+        }
+        h = xxh_rotl(v1, 1) + xxh_rotl(v2, 7) + xxh_rotl(v3, 12) + xxh_rotl(v4, 18);
+        h = xxh_merge(xxh_merge(xxh_merge(xxh_merge(h, v1), v2), v3), v4);
+    }
+    else{
+        h = seed + XXH_P5;
+    }
+    h += len;
+    for(; p + 8 <= e; p += 8){
+        h = xxh_rotl(h ^ xxh_round(0, xxh_read64(p)), 27) * XXH_P1 + XXH_P4;
+    }
+    if(p + 4 <= e){
+        h = xxh_rotl(h ^ (xxh_read32(p) * XXH_P1), 23) * XXH_P2 + XXH_P3;
+        p += 4;
+    }
+    for(; p < e; p++){
+        h = xxh_rotl(h ^ (*p * XXH_P5), 11) * XXH_P1;
+    }
+    h ^= h >> 33;
+    h *= XXH_P2;
+    h ^= h >> 29;
+    h *= XXH_P3;
+    h ^= h >> 32;
+    return h;
+}
+
+//everything a result depends on
+typedef struct cache_key{
+    uint64_t trace_hash;
+    uint64_t build_hash;
+    uint64_t rob_size, iq_size, width;
+    int32_t latency[MAX_OP_TYPES];
+    int32_t units[MAX_OP_TYPES];
+}cache_key;
+
+typedef struct cache_entry{
+    char magic[CACHE_MAGIC_LEN];
+    uint32_t version;
+    uint32_t reserved;
+    cache_key key;
+    uint64_t num_instr, num_cycles;
+}cache_entry;
+
+//DIR/stat/<dev>-<inode>: the hash of a file as of the recorded size and times
+typedef struct cache_stat{
+    uint64_t size;
+    int64_t mtime_sec, mtime_nsec, ctime_sec, ctime_nsec;
+    uint64_t hash;
+}cache_stat;
+
+class Result_Cache{
+public:
+    std::string dir;
+    uint64_t build_hash;
+
+    Result_Cache() : build_hash(0){}
+
+    //create DIR (and DIR/stat) if needed and identify the running binary, returns false if DIR is unusable
+    bool open(const char *cache_dir){
+        dir = cache_dir;
+        if((mkdir(dir.c_str(), 0777) != 0 && errno != EEXIST) || (mkdir((dir + "/stat").c_str(), 0777) != 0 && errno != EEXIST)){
+            return false;
+        }
+        char exe[4096];
+        ssize_t n = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+        if(n > 0){
+            exe[n] = '\0';
+            if(hash_file(exe, build_hash)){
+                return true;
+            }
+        }
+        //no way to read the binary: the build time is the next best identity
+        const char *stamp = __DATE__ " " __TIME__;
+        build_hash = hash_bytes(stamp, strlen(stamp), 0);
+        return true;
+    }
+
+    //hash of a file's contents, read only if the stat side cache has no hash for its current size/times
+    bool hash_file(const char *file, uint64_t &hash){
+        struct stat st;
+        if(stat(file, &st) != 0){
+            return false;
+        }
+        cache_stat cur;
+        memset(&cur, 0, sizeof(cur));
+        cur.size = st.st_size;
+        cur.mtime_sec = st.st_mtim.tv_sec;
+        cur.mtime_nsec = st.st_mtim.tv_nsec;
+        cur.ctime_sec = st.st_ctim.tv_sec;
+        cur.ctime_nsec = st.st_ctim.tv_nsec;
+        char name[64];
+        snprintf(name, sizeof(name), "/stat/%llx-%llx", (unsigned long long)st.st_dev, (unsigned long long)st.st_ino);
+        std::string stat_file = dir + name;
+
+        cache_stat old;
+        if(read_file(stat_file, &old, sizeof(old)) && memcmp(&old, &cur, offsetof(cache_stat, hash)) == 0){
+            hash = old.hash;
+            return true;
+        }
+        int fd = ::open(file, O_RDONLY);
+        if(fd < 0){
+            return false;
+        }
+        std::vector<char> buf(CACHE_CHUNK);
+        uint64_t h = 0;
+        ssize_t n;
+        while((n = read(fd, &buf[0], buf.size())) > 0){
+            h = hash_bytes(&buf[0], n, h);
+        }
+        close(fd);
+        if(n < 0){
+            return false;
+        }
+        cur.hash = hash = h;
+        write_file(stat_file, &cur, sizeof(cur));     //only a hint, losing it costs a rehash
+        return true;
+    }
+
+    void make_key(uint64_t trace_hash, const proc_params &params, const Op_Table &ops, cache_key &key) const {
+        memset(&key, 0, sizeof(key));
+        key.trace_hash = trace_hash;
+        key.build_hash = build_hash;
+        key.rob_size = params.rob_size;
+        key.iq_size = params.iq_size;
+        key.width = params.width;
+        for(int i = 0; i < MAX_OP_TYPES; i++){
+            key.latency[i] = ops.latency[i];
+            key.units[i] = ops.units[i];
+        }
+    }
+
+    //DIR/<key hash>, the entry's files add .sum, .tlog and .tlog.idx
+    std::string path(const cache_key &key) const {
+        char name[32];
+        snprintf(name, sizeof(name), "/%016llx", (unsigned long long)hash_bytes(&key, sizeof(key), 0));
+        return dir + name;
+    }
+
+    //a stored result for key; with_log also requires its timing log
+    bool lookup(const cache_key &key, bool with_log, cache_entry &entry) const {
+        std::string base = path(key);
+        if(!read_file(base + ".sum", &entry, sizeof(entry)) || memcmp(entry.magic, CACHE_MAGIC, CACHE_MAGIC_LEN) != 0
+                || entry.version != CACHE_VERSION || memcmp(&entry.key, &key, sizeof(key)) != 0){
+            return false;
+        }
+        return !with_log || (access((base + ".tlog").c_str(), R_OK) == 0 && access((base + ".tlog.idx").c_str(), R_OK) == 0);
+    }
+
+    //record a result; a timing log must already be in place (see commit())
+    bool store(const cache_key &key, uint64_t num_instr, uint64_t num_cycles) const {
+        cache_entry entry;
+        memset(&entry, 0, sizeof(entry));
+        memcpy(entry.magic, CACHE_MAGIC, CACHE_MAGIC_LEN);
+        entry.version = CACHE_VERSION;
+        entry.key = key;
+        entry.num_instr = num_instr;
+        entry.num_cycles = num_cycles;
+        return write_file(path(key) + ".sum", &entry, sizeof(entry));
+    }
+
+    //this process's temporary name for file, and moving it into place
+    static std::string temp_name(const std::string &file){
+        return file + ".tmp." + std::to_string(getpid());
+    }
+    static bool commit(const std::string &file){
+        return rename(temp_name(file).c_str(), file.c_str()) == 0;
+    }
+
+    static bool read_file(const std::string &file, void *p, size_t n){
+        FILE *fp = fopen(file.c_str(), "rb");
+        if(fp == NULL){
+            return false;
+        }
+        bool ok = fread(p, 1, n, fp) == n;
+        fclose(fp);
+        return ok;
+    }
+    static bool write_file(const std::string &file, const void *p, size_t n){
+        FILE *fp = fopen(temp_name(file).c_str(), "wb");
+        if(fp == NULL){
+            return false;
+        }
+        bool ok = fwrite(p, 1, n, fp) == n;
+        ok = (fclose(fp) == 0) && ok;
+        if(!ok || !commit(file)){
+            unlink(temp_name(file).c_str());
+            return false;
+        }
+        return true;
+    }
+};
+
+//copy a whole file, for handing out a cached binary log
+inline bool copy_file(const std::string &from, const char *to){
+    FILE *in = fopen(from.c_str(), "rb");
+    if(in == NULL){
+        return false;
+    }
+    FILE *out = fopen(to, "wb");
+    if(out == NULL){
+        fclose(in);
+        return false;
+    }
+    std::vector<char> buf(CACHE_CHUNK);
+    size_t n;
+    bool ok = true;
+    while(ok && (n = fread(&buf[0], 1, buf.size(), in)) > 0){
+        ok = fwrite(&buf[0], 1, n, out) == n;
+    }
+    ok = !ferror(in) && ok;
+    fclose(in);
+    return (fclose(out) == 0) && ok;
+}
+
+//decode a binary timing log into out (the text format), returns false on a corrupt log
+inline bool replay_timing_log(const std::string &log, Timing_Writer &out){
+    int fd = open(log.c_str(), O_RDONLY);
+    struct stat st;
+    if(fd < 0 || fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(timing_log_header)){
+        if(fd >= 0){
+            close(fd);
+        }
+        return false;
+    }
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED){
+        return false;
+    }
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+    const char *p = (const char *)map + sizeof(timing_log_header), *e = (const char *)map + st.st_size;
+    timing_record rec;
+    int64_t prev_fetch = 0;
+    for(uint64_t seq = 0; p != NULL && p < e; seq++){
+        if((p = get_timing_record(p, e, seq, prev_fetch, rec)) != NULL){
+            prev_fetch = rec.begin[STAGE_FE];
+            out.put(rec);
+        }
+    }
+    munmap(map, st.st_size);
+    return p != NULL;
+}
+
+//write a cached run's timing output as the run itself would have: the binary log and its index
+//copied to timing_file, or text decoded into timing_file (stdout if NULL)
+inline bool write_cached_timing(const std::string &log, timing_format timing, const char *timing_file){
+    if(timing == TIMING_BINARY){
+        return copy_file(log, timing_file) && copy_file(log + ".idx", (std::string(timing_file) + ".idx").c_str());
+    }
+    FILE *fp = (timing_file == NULL) ? stdout : fopen(timing_file, "wb");
+    if(fp == NULL){
+        return false;
+    }
+    bool ok;
+    {
+        Timing_Writer writer(fp, TIMING_TEXT);
+        ok = replay_timing_log(log, writer);
+    }
+    return (fp == stdout || fclose(fp) == 0) && ok;
+}
+
+#endif
@@ -0,0 +1,267 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "sim_proc.h"
+#include "sim_ref.h"
+
+/*  Lockstep differential checker: runs the optimized engine (the core sim would pick, see
+    Select_Core) and the reference engine (sim_ref.h) side by side in one process and compares a
+    digest of their ROB, RMT, IQ, latch and EX/WB state after every cycle. At the first cycle they
+    disagree it stops and prints both states, differing lines marked, so a change to the stage
+    functions in sim_proc.h can be checked much more closely than by a final diff against
+    validation/val*.txt.
+
+    Example:-
+    sim_check 256 32 4 gcc_trace.txt
+    sim_check --fu-config=op_classes.cfg 64 16 4 gcc_trace.bin
+    sim_check --random=1000
+    sim_check --random=200:42 --length=20000 --clock=cycle
+
+    --random=N[:SEED]  N synthetic runs instead of a trace: each draws a configuration (a third of
+                       them one with a specialized core), op classes (half of them with FU limits)
+                       and a trace with short dependency chains. SEED defaults to 1; run i uses
+                       seed SEED+i, so --random=1:<that seed> repeats a failing run
+    --length=L         longest synthetic trace (default 2000 instr.)
+    --fu-config=FILE   op classes, as for sim (trace runs only)
+    --clock=C          event (default): the optimized engine skips idle cycles as in sim, and the
+                       states are compared every cycle it stops at; cycle: every cycle
+*/
+
+//xorshift64*, as in trace_gen
+class Random{
+public:
+    uint64_t s;
+    Random(uint64_t seed) : s(seed * 0x9E3779B97F4A7C15ULL + 1){}
+    uint64_t next(){
+        s ^= s >> 12;
+        s ^= s << 25;
+        s ^= s >> 27;
+        return s * 0x2545F4914F6CDD1DULL;
+    }
+    unsigned long below(unsigned long n){ return next() % n; }
+};
+
+//print both digests of a diverged cycle, the sections that differ in full
+void Dump_Divergence(const Sim_State &sim, const Ref_State &ref)
+{
+    State_Digest a(true), b(true);
+    Digest_State(sim, a);
+    Digest_State(ref, b);
+    size_t n = (a.lines.size() > b.lines.size()) ? a.lines.size() : b.lines.size();
+    std::vector<bool> show(n, false);
+    for (size_t i = 0; i < n; i++)
+    {
+        if (i < a.lines.size() && i < b.lines.size() && a.lines[i] == b.lines[i])
+            continue;
+        //the whole section of a differing line
+        const std::string &line = (i < a.lines.size()) ? a.lines[i] : b.lines[i];
+        std::string section = line.substr(0, line.find(' '));
+        for (size_t j = 0; j < n; j++)
+        {
+            const std::string &other = (j < a.lines.size()) ? a.lines[j] : b.lines[j];
+            if (other.compare(0, section.size() + 1, section + " ") == 0)
+                show[j] = true;
+        }
+    }
+    printf("# %-46s   %s\n", "optimized", "reference");
+    for (size_t i = 0; i < n; i++)
+    {
+        if (!show[i])
+            continue;
+        const char *x = (i < a.lines.size()) ? a.lines[i].c_str() : "";
+        const char *y = (i < b.lines.size()) ? b.lines[i].c_str() : "";
+        printf("%c %-46s   %s\n", strcmp(x, y) != 0 ? '*' : ' ', x, y);
+    }
+}
+
+//run both engines over records until both finish or they disagree; returns false after dumping a divergence
+bool Lockstep(const proc_params &params, const Op_Table &ops, bool event_clock, const trace_record *records, size_t n,
+        uint64_t &compared)
+{
+    Memory_Trace_Reader opt_trace(records, n), ref_trace(records, n);
+    Sim_State sim(params);
+    sim.timing_out = NULL;
+    sim.ops = ops;
+    sim.event_clock = event_clock;
+    step_fn step = Select_Core(sim);
+    Ref_State ref(params, ops);
+
+    bool opt_running = true, ref_running = true;
+    while (true)
+    {
+        //an idle stretch the optimized engine skipped is stepped through one cycle at a time
+        while (ref_running && ref.num_cycles < sim.num_cycles)
+            ref_running = Ref_Step(ref, ref_trace);
+        State_Digest a, b;
+        Digest_State(sim, a);
+        Digest_State(ref, b);
+        compared++;
+        if (a.hash != b.hash || opt_running != ref_running)
+        {
+            printf("# === Divergence at cycle %llu ===\n", (unsigned long long)sim.num_cycles);
+            printf("# ROB_SIZE %lu IQ_SIZE %lu WIDTH %lu, %llu instr., %s core\n", params.rob_size, params.iq_size,
+                    params.width, (unsigned long long)n, (step == Step<Runtime_Core>) ? "generic" : "specialized");
+            if (opt_running != ref_running)
+                printf("# the %s engine has finished, the other hasn't\n", opt_running ? "reference" : "optimized");
+            Dump_Divergence(sim, ref);
+            return false;
+        }
+        if (!opt_running)
+            return true;
+        opt_running = step(sim, opt_trace);
+    }
+}
+
+//one synthetic run: a configuration, op classes and a trace drawn from seed
+bool Random_Run(uint64_t seed, unsigned long max_length, bool event_clock, uint64_t &compared)
+{
+    Random rng(seed);
+    proc_params params;
+    Op_Table ops;
+    static const std::vector<proc_params> fixed = Fixed_Core_Configs();
+    if (!fixed.empty() && rng.below(3) == 0)
+        params = fixed[rng.below(fixed.size())];
+    else
+    {
+        //a full bundle has to fit in the ROB and the IQ
+        params.width = 1 + rng.below(8);
+        params.iq_size = params.width + ((rng.below(4) == 0) ? 0 : rng.below(64));
+        params.rob_size = params.width + ((rng.below(4) == 0) ? 0 : rng.below(256));
+        if (rng.below(2) == 0)
+        {
+            for (int op = 0; op < 4; op++)
+            {
+                ops.latency[op] = 1 + rng.below(6);
+                ops.units[op] = rng.below(3);
+                ops.limited = ops.limited || ops.units[op] != 0;
+            }
+            ops.custom = true;
+        }
+    }
+
+    //dependences mostly on the last few dsts, so the IQ sees long wakeup chains
+    unsigned long length = rng.below(max_length + 1);
+    std::vector<trace_record> records(length);
+    int recent[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+    uint64_t pc = 0x1000;
+    for (unsigned long i = 0; i < length; i++)
+    {
+        trace_record &rec = records[i];
+        pc = (rng.below(16) == 0) ? 0x1000 + 4 * rng.below(4096) : pc + 4;
+        rec.pc = pc;
+        rec.op_type = (rng.below(64) == 0) ? MAX_OP_TYPES + rng.below(8) : rng.below(4);
+        int16_t *srcs[2] = {&rec.src1, &rec.src2};
+        for (int k = 0; k < 2; k++)
+        {
+            unsigned long r = rng.below(8);
+            *srcs[k] = (r < 2) ? -1 : ((r < 6) ? recent[rng.below(8)] : rng.below(67));
+        }
+        rec.dst = (rng.below(8) == 0) ? -1 : rng.below(67);
+        if (rec.dst != -1)
+            recent[rng.below(8)] = rec.dst;
+    }
+
+    if (!Lockstep(params, ops, event_clock, records.data(), records.size(), compared))
+    {
+        printf("# seed %llu, op classes %s\n", (unsigned long long)seed, ops.custom ? "custom" : "default");
+        return false;
+    }
+    return true;
+}
+
+int main (int argc, char* argv[])
+{
+    unsigned long runs = 0, max_length = 2000;
+    uint64_t seed = 1;
+    bool event_clock = true;
+    Op_Table ops;
+    int argi = 1;
+
+    while (argi < argc && strncmp(argv[argi], "--", 2) == 0)
+    {
+        if (strncmp(argv[argi], "--random=", 9) == 0)
+        {
+            char *q;
+            runs = strtoul(argv[argi] + 9, &q, 10);
+            if (*q == ':')
+                seed = strtoull(q + 1, &q, 10);
+            if (*q != '\0' || runs == 0)
+            {
+                printf("Error: Malformed option %s\n", argv[argi]);
+                exit(EXIT_FAILURE);
+            }
+        }
+        else if (strncmp(argv[argi], "--length=", 9) == 0)
+            max_length = strtoul(argv[argi] + 9, NULL, 10);
+        else if (strncmp(argv[argi], "--fu-config=", 12) == 0)
+        {
+            if (!ops.load(argv[argi] + 12))
+                exit(EXIT_FAILURE);
+        }
+        else if (strcmp(argv[argi], "--clock=event") == 0)
+            event_clock = true;
+        else if (strcmp(argv[argi], "--clock=cycle") == 0)
+            event_clock = false;
+        else
+        {
+            printf("Error: Unknown option %s\n", argv[argi]);
+            exit(EXIT_FAILURE);
+        }
+        argi++;
+    }
+
+    uint64_t compared = 0;
+    if (runs != 0)
+    {
+        if (argc != argi)
+        {
+            printf("Error: --random takes no trace or configuration\n");
+            exit(EXIT_FAILURE);
+        }
+        for (unsigned long i = 0; i < runs; i++)
+            if (!Random_Run(seed + i, max_length, event_clock, compared))
+                exit(EXIT_FAILURE);
+        printf("# %lu synthetic runs, %llu cycles compared, no divergence\n", runs, (unsigned long long)compared);
+        return 0;
+    }
+
+    if (argc - argi != 4)
+    {
+        printf("Error: Wrong number of inputs:%d\n", argc-argi);
+        printf("Usage: %s [--fu-config=FILE] [--clock=C] <rob_size> <iq_size> <width> <trace_file>\n", argv[0]);
+        printf("       %s --random=N[:SEED] [--length=L] [--clock=C]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    proc_params params;
+    params.rob_size = strtoul(argv[argi], NULL, 10);
+    params.iq_size  = strtoul(argv[argi+1], NULL, 10);
+    params.width    = strtoul(argv[argi+2], NULL, 10);
+    const char *trace_file = argv[argi+3];
+    if (params.width == 0 || params.iq_size < params.width || params.rob_size < params.width)
+    {
+        printf("Error: IQ_SIZE and ROB_SIZE must hold a bundle of WIDTH instr.\n");
+        exit(EXIT_FAILURE);
+    }
+    Trace_Image img;
+    if (!load_trace_image(trace_file, img))
+    {
+        printf("Error: Unable to open file %s\n", trace_file);
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < img.num_records; i++)
+    {
+        const trace_record &rec = img.records[i];
+        if (rec.dst >= 67 || rec.src1 >= 67 || rec.src2 >= 67)
+        {
+            printf("Error: Instruction %llu names a register beyond 66\n", (unsigned long long)i);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (!Lockstep(params, ops, event_clock, img.records, img.num_records, compared))
+        exit(EXIT_FAILURE);
+    printf("# %s: %llu instr., %llu cycles compared, no divergence\n", trace_file, (unsigned long long)img.num_records,
+            (unsigned long long)compared);
+    return 0;
+}
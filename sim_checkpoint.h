@@ -0,0 +1,216 @@
+#ifndef SIM_CHECKPOINT_H
+#define SIM_CHECKPOINT_H
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "sim_proc.h"
+
+//Checkpoints-----------------------------------------------------------------------------------------------------------
+//
+//./sim --checkpoint=FILE --checkpoint-every=N <rob_size> <iq_size> <width> <trace_file>
+//      writes FILE.<cycle> every N cycles
+//./sim --resume=FILE.<cycle> <rob_size> <iq_size> <width> <trace_file>
+//      continues from the checkpoint; the configuration (and --fu-config) must match the one it was taken with
+//
+//a checkpoint is taken between cycles and holds the whole Sim_State: counters, slab, every
+//pipeline latch, ROB head/tail/table, IQ, RMT, op classes and --stats counters, plus how far the trace has been read (the
+//instr. fetched so far) and how much per-instruction timing output had been written.
+//on resume the trace is skipped to that point (a seek for binary traces) and a --out file is
+//cut back to the recorded length, so the output matches an uninterrupted run.
+//resuming the same checkpoint several times forks one warmed-up machine into several runs
+//
+//layout: checkpoint_header, then each structure in the order of Save_Checkpoint;
+//a vector is a uint64 element count followed by its elements
+
+#define CHECKPOINT_MAGIC    "SIMCKPT"
+#define CHECKPOINT_MAGIC_LEN 8
+#define CHECKPOINT_VERSION  4
+
+typedef struct checkpoint_header{
+    char magic[CHECKPOINT_MAGIC_LEN];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t rob_size, iq_size, width;
+    uint64_t trace_offset;      //records consumed from the trace
+    uint64_t timing_offset;     //bytes of timing output written, 0 for stdout/none
+    uint64_t index_offset;      //bytes of the binary log's seek index written
+    int64_t timing_prev_fetch;  //binary timing: FE begin of the last record written
+}checkpoint_header;
+
+//plain binary reads/writes of one checkpoint file, a failed read/write sticks in ok
+class Checkpoint_File{
+public:
+    FILE *FP;
+    bool ok;
+    Checkpoint_File(FILE *fp) : FP(fp), ok(fp != NULL){}
+
+    void put(const void *p, size_t n){
+        ok = ok && fwrite(p, 1, n, FP) == n;
+    }
+    void get(void *p, size_t n){
+        ok = ok && fread(p, 1, n, FP) == n;
+    }
+    template <class T> void put_vec(const std::vector<T> &v){
+        uint64_t n = v.size();
+        put(&n, sizeof(n));
+        if(n != 0){
+            put(&v[0], n * sizeof(T));
+        }
+    }
+    //elements are read into v, whose size must already match (all vectors are sized by the configuration)
+    //unless any_size is set
+    template <class T> void get_vec(std::vector<T> &v, bool any_size = false){
+        uint64_t n = 0;
+        get(&n, sizeof(n));
+        if(!ok || (n != v.size() && !any_size)){
+            ok = false;
+            return;
+        }
+        v.resize(n);
+        if(n != 0){
+            get(&v[0], n * sizeof(T));
+        }
+    }
+    void put_latch(const Latch &l){
+        put(&l.count, sizeof(l.count));
+        put_vec(l.idx);
+    }
+    void get_latch(Latch &l){
+        get(&l.count, sizeof(l.count));
+        get_vec(l.idx);
+        ok = ok && l.count <= l.idx.size();
+    }
+};
+
+//write a checkpoint of sim (and of timing_out, if given) to file, via a temporary so a crash never leaves half a checkpoint
+inline bool Save_Checkpoint(const char *file, const Sim_State &sim, Timing_Writer *timing_out){
+    std::string tmp = std::string(file) + ".tmp";
+    checkpoint_header hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, CHECKPOINT_MAGIC, CHECKPOINT_MAGIC_LEN);
+    hdr.version = CHECKPOINT_VERSION;
+    hdr.rob_size = sim.params.rob_size;
+    hdr.iq_size = sim.params.iq_size;
+    hdr.width = sim.params.width;
+    hdr.trace_offset = sim.num_instr;
+    if(timing_out != NULL){
+        timing_out->flush();
+        hdr.timing_offset = timing_out->offset();
+        hdr.timing_prev_fetch = timing_out->prev_fetch;
+        if(timing_out->index != NULL){
+            hdr.index_offset = ftell(timing_out->index);
+        }
+    }
+
+    Checkpoint_File ck(fopen(tmp.c_str(), "wb"));
+    ck.put(&hdr, sizeof(hdr));
+    ck.put(&sim.num_cycles, sizeof(sim.num_cycles));
+    ck.put(&sim.num_instr, sizeof(sim.num_instr));
+    ck.put(&sim.seq, sizeof(sim.seq));
+    ck.put(&sim.EOF_flag, sizeof(sim.EOF_flag));
+    ck.put(&sim.slab_next, sizeof(sim.slab_next));
+    ck.put_vec(sim.slab);
+    ck.put_latch(sim.decode_bundle);
+    ck.put_latch(sim.rename_bundle);
+    ck.put_latch(sim.regRead_bundle);
+    ck.put_latch(sim.dispatch_bundle);
+    ck.put_latch(sim.writeback_bundle);
+    ck.put_latch(sim.execute_list);
+    ck.put(&sim.ROB_table.head, sizeof(sim.ROB_table.head));
+    ck.put(&sim.ROB_table.tail, sizeof(sim.ROB_table.tail));
+    ck.put(&sim.ROB_table.count, sizeof(sim.ROB_table.count));
+    ck.put_vec(sim.ROB_table.table);
+    const Issue_Queue &iq = sim.issueQueue;
+    ck.put(&iq.count, sizeof(iq.count));
+    ck.put_vec(iq.src1_tag);
+    ck.put_vec(iq.src2_tag);
+    ck.put_vec(iq.rob_tag);
+    ck.put_vec(iq.slot_of);
+    ck.put_vec(iq.entry);
+    ck.put_vec(iq.free_slots);
+    ck.put_vec(iq.ready);
+    ck.put(sim.RMT_table.reg_list, sizeof(sim.RMT_table.reg_list));
+    ck.put(&sim.ops, sizeof(sim.ops));
+    bool has_stats = sim.stats != NULL;
+    ck.put(&has_stats, sizeof(has_stats));
+    if(has_stats){
+        ck.put(sim.stats->stalls, sizeof(sim.stats->stalls));
+        ck.put_vec(sim.stats->rob);
+        ck.put_vec(sim.stats->iq);
+        ck.put_vec(sim.stats->execute);
+    }
+    bool ok = ck.ok;
+    if(ck.FP != NULL){
+        ok = (fclose(ck.FP) == 0) && ok;
+    }
+    if(!ok || rename(tmp.c_str(), file) != 0){
+        remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+//restore sim, which must be freshly built with the checkpoint's configuration, returns false on a
+//missing, corrupt or mismatched checkpoint
+inline bool Load_Checkpoint(const char *file, Sim_State &sim, checkpoint_header &hdr){
+    Checkpoint_File ck(fopen(file, "rb"));
+    ck.get(&hdr, sizeof(hdr));
+    if(!ck.ok || memcmp(hdr.magic, CHECKPOINT_MAGIC, CHECKPOINT_MAGIC_LEN) != 0 || hdr.version != CHECKPOINT_VERSION
+            || hdr.rob_size != sim.params.rob_size || hdr.iq_size != sim.params.iq_size || hdr.width != sim.params.width){
+        ck.ok = false;
+    }
+    ck.get(&sim.num_cycles, sizeof(sim.num_cycles));
+    ck.get(&sim.num_instr, sizeof(sim.num_instr));
+    ck.get(&sim.seq, sizeof(sim.seq));
+    ck.get(&sim.EOF_flag, sizeof(sim.EOF_flag));
+    ck.get(&sim.slab_next, sizeof(sim.slab_next));
+    ck.get_vec(sim.slab);
+    ck.get_latch(sim.decode_bundle);
+    ck.get_latch(sim.rename_bundle);
+    ck.get_latch(sim.regRead_bundle);
+    ck.get_latch(sim.dispatch_bundle);
+    ck.get_latch(sim.writeback_bundle);
+    ck.get_latch(sim.execute_list);
+    ck.get(&sim.ROB_table.head, sizeof(sim.ROB_table.head));
+    ck.get(&sim.ROB_table.tail, sizeof(sim.ROB_table.tail));
+    ck.get(&sim.ROB_table.count, sizeof(sim.ROB_table.count));
+    ck.get_vec(sim.ROB_table.table);
+    Issue_Queue &iq = sim.issueQueue;
+    ck.get(&iq.count, sizeof(iq.count));
+    ck.get_vec(iq.src1_tag);
+    ck.get_vec(iq.src2_tag);
+    ck.get_vec(iq.rob_tag);
+    ck.get_vec(iq.slot_of);
+    ck.get_vec(iq.entry);
+    ck.get_vec(iq.free_slots, true);
+    ck.get_vec(iq.ready);
+    ck.get(sim.RMT_table.reg_list, sizeof(sim.RMT_table.reg_list));
+    Op_Table ops;
+    ck.get(&ops, sizeof(ops));
+    //field by field, the struct's padding is whatever was on the stack
+    ck.ok = ck.ok && memcmp(ops.latency, sim.ops.latency, sizeof(ops.latency)) == 0
+            && memcmp(ops.units, sim.ops.units, sizeof(ops.units)) == 0 && ops.limited == sim.ops.limited;
+    //counters taken without --stats leave a resumed run's counters starting from the checkpoint
+    bool has_stats = false;
+    ck.get(&has_stats, sizeof(has_stats));
+    if(has_stats){
+        Sim_Stats unused(sim.params.rob_size, sim.params.iq_size);
+        Sim_Stats *stats = (sim.stats != NULL) ? sim.stats : &unused;
+        ck.get(stats->stalls, sizeof(stats->stalls));
+        ck.get_vec(stats->rob);
+        ck.get_vec(stats->iq);
+        ck.get_vec(stats->execute);
+    }
+    bool ok = ck.ok && iq.count + iq.free_slots.size() == iq.iq_size && sim.slab_next < sim.slab.size()
+            && hdr.trace_offset == sim.num_instr && sim.ROB_table.count <= sim.ROB_table.rob_size
+            && (unsigned long)sim.ROB_table.head < sim.ROB_table.rob_size && (unsigned long)sim.ROB_table.tail < sim.ROB_table.rob_size;
+    if(ck.FP != NULL){
+        fclose(ck.FP);
+    }
+    return ok;
+}
+
+#endif
@@ -0,0 +1,31 @@
+#include "sim_proc.h"
+
+/*  Instantiates the compile-time specialized cores. The Makefile passes the SPECIALIZE list
+    as SIM_FIXED_CORES, X(rob_size, iq_size, width) per configuration, to this file only.
+*/
+
+#ifndef SIM_FIXED_CORES
+#define SIM_FIXED_CORES
+#endif
+
+step_fn Select_Core(const Sim_State &sim){
+    const proc_params &p = sim.params;
+    if(!sim.ops.custom){
+#define X(R, Q, W) \
+        if(p.rob_size == R && p.iq_size == Q && p.width == W){ \
+            return Step<Fixed_Core<R, Q, W> >; \
+        }
+        SIM_FIXED_CORES
+#undef X
+    }
+    return Step<Runtime_Core>;
+}
+
+std::vector<proc_params> Fixed_Core_Configs(){
+    std::vector<proc_params> configs;
+#define X(R, Q, W) \
+    { proc_params p = {R, Q, W}; configs.push_back(p); }
+    SIM_FIXED_CORES
+#undef X
+    return configs;
+}
@@ -0,0 +1,231 @@
+#ifndef SIM_INTERVAL_H
+#define SIM_INTERVAL_H
+
+#include <cstdlib>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "sim_proc.h"
+
+//Parallel Interval Simulation------------------------------------------------------------------------------------------
+//
+//./sim --parallel=N[:WARMUP[:TOL]] [--jobs=J] <rob_size> <iq_size> <width> <trace_file>
+//
+//the trace is cut into N contiguous intervals, simulated side by side on J threads (default: all
+//cores). each interval starts from a drained machine WARMUP instr. before its first one, and its
+//cycles are the retire cycle of its last instr. minus that of the instr. just before it, both
+//taken in its own run; the total is the sum over the intervals. WARMUP defaults to 20000
+//
+//retirement, issue and FU selection are all oldest first, so a later instr. never delays an
+//earlier one and an interval's run is exact up to its end; the only error is in where it starts.
+//each run goes on for a check window past its interval's end, so the instr. around a boundary
+//are simulated twice: by the previous interval's run (settled) and by the next one's (from cold,
+//its warmup then its first instr.). the largest difference between the two of an instr.'s retire
+//cycle, relative to the last instr. before the boundary, is the error estimate for that boundary.
+//once the cold run has settled into the same state the two agree, as the machine holds nothing
+//that outlives the instr. in flight (see sim_sample.h). the window is INTERVAL_CHECK instr. or
+//two ROBs' worth, whichever is more, on each side of the boundary
+//
+//while the estimated error is above TOL percent of the total cycles (default 0.1), the warmup of
+//every boundary that disagrees is doubled and its interval run again. TOL 0 lengthens warmups
+//until no boundary window shows any error; that only says the two runs agreed inside the
+//windows, warmup state outside them can still differ. only a warmup reaching back to the start
+//of the trace is exact
+
+#define INTERVAL_WARMUP     20000
+#define INTERVAL_CHECK      1000    //instr. compared on each side of a boundary, at least
+#define INTERVAL_TOLERANCE  0.1     //percent
+
+typedef struct interval_params{
+    unsigned long intervals, warmup;
+    double tolerance;               //percent of the total cycles
+}interval_params;
+
+typedef struct interval_run{
+    uint64_t begin, end;            //instr. [begin, end) of the trace are measured
+    uint64_t warmup;                //instr. simulated before begin
+    uint64_t start_cycle;           //retire cycle of instr. begin-1 (0 for the first interval)
+    uint64_t end_cycle;             //retire cycle of instr. end-1, or the last cycle of the trace
+    std::vector<uint64_t> head;     //retire cycles of the check window around begin
+    std::vector<uint64_t> tail;     //retire cycles of the check window around end
+    size_t head_split, tail_split;  //instr. of each window before its boundary
+    double error;                   //estimated cycles off at begin
+}interval_run;
+
+typedef struct interval_result{
+    uint64_t num_instr, num_cycles;
+    double error;                   //estimated cycles off in num_cycles
+    unsigned long num_intervals, min_warmup, max_warmup;
+}interval_result;
+
+//parse N[:WARMUP[:TOL]], returns false on a malformed schedule
+inline bool parse_interval_params(const char *arg, interval_params &ip){
+    char *q;
+    ip.warmup = INTERVAL_WARMUP;
+    ip.tolerance = INTERVAL_TOLERANCE;
+    ip.intervals = strtoul(arg, &q, 10);
+    if(q == arg){
+        return false;
+    }
+    if(*q == ':'){
+        ip.warmup = strtoul(q + 1, &q, 10);
+        if(*q == ':'){
+            const char *p = q + 1;
+            ip.tolerance = strtod(p, &q);
+            if(q == p){
+                return false;
+            }
+        }
+    }
+    return *q == '\0' && ip.intervals != 0 && ip.warmup != 0 && ip.tolerance >= 0;
+}
+
+//retire cycle stamps of instr. [lo, lo+v.size()) among those retired, instr. [a, b), in cycle
+inline void stamp_retired(std::vector<uint64_t> &v, uint64_t lo, uint64_t a, uint64_t b, uint64_t cycle){
+    uint64_t hi = lo + v.size();
+    for(uint64_t i = (a > lo) ? a : lo; i < b && i < hi; i++){
+        v[i - lo] = cycle;
+    }
+}
+
+//simulate one interval with its current warmup, and past its end through the check window
+inline void Run_Interval(const Trace_Image &img, const proc_params &params, const Op_Table &ops, uint64_t check,
+        bool last, interval_run &iv){
+    //Fetch takes WIDTH instr. at a time from the start of the trace and bundles move through the
+    //front end whole, so a run starts (and, unless at the end of the trace, stops) on a bundle
+    //boundary of the serial run, or its bundles never line up with it
+    uint64_t n = img.num_records, from = iv.begin - iv.warmup;
+    from -= from % params.width;
+    iv.warmup = iv.begin - from;
+    uint64_t after = (n - iv.end < check) ? n - iv.end : check;
+    if(iv.end + after != n){
+        after -= (iv.end + after) % params.width;
+    }
+    Memory_Trace_Reader trace(img.records + from, iv.end + after - from);
+    Sim_State sim(params);
+    sim.timing_out = NULL;
+    sim.ops = ops;
+    step_fn step = Select_Core(sim);
+    iv.head_split = (iv.warmup < check) ? iv.warmup : check;
+    iv.tail_split = (iv.end - iv.begin < check) ? iv.end - iv.begin : check;
+    iv.head.assign(iv.head_split + ((n - iv.begin < check) ? n - iv.begin : check), 0);
+    iv.tail.assign(iv.tail_split + after, 0);
+    uint64_t head_lo = iv.begin - iv.head_split, tail_lo = iv.end - iv.tail_split;
+
+    //instr. retire at the start of a step, in the cycle num_cycles held before it
+    bool running = true;
+    while(running){
+        uint64_t cycle = sim.num_cycles, retired = sim.seq;
+        running = step(sim, trace);
+        if(sim.seq != retired){
+            stamp_retired(iv.head, head_lo, from + retired, from + sim.seq, cycle);
+            stamp_retired(iv.tail, tail_lo, from + retired, from + sim.seq, cycle);
+        }
+    }
+    iv.start_cycle = (iv.head_split == 0) ? 0 : iv.head[iv.head_split - 1];
+    iv.end_cycle = last ? sim.num_cycles : iv.tail[iv.tail_split - 1];
+}
+
+//error estimate at the boundary between a settled run (prev.tail) and a cold one (next.head)
+inline double boundary_error(const interval_run &prev, const interval_run &next){
+    size_t before = (prev.tail_split < next.head_split) ? prev.tail_split : next.head_split;
+    size_t len = before + (next.head.size() - next.head_split);
+    const uint64_t *w = &prev.tail[prev.tail_split - before], *c = &next.head[next.head_split - before];
+    double worst = 0;
+    for(size_t k = 0; k < len; k++){
+        double d = double(int64_t(w[k] - w[before - 1]) - int64_t(c[k] - c[before - 1]));
+        if(d < 0){
+            d = -d;
+        }
+        if(d > worst){
+            worst = d;
+        }
+    }
+    return worst;
+}
+
+//simulate the whole trace image as ip.intervals intervals on jobs threads
+inline void Run_Intervals(const Trace_Image &img, const proc_params &params, const Op_Table &ops, const interval_params &ip,
+        unsigned jobs, interval_result &res){
+    uint64_t n = img.num_records;
+    uint64_t len = (n + ip.intervals - 1) / ip.intervals;
+    uint64_t check = (2 * params.rob_size > INTERVAL_CHECK) ? 2 * params.rob_size : INTERVAL_CHECK;
+    std::vector<interval_run> runs;
+    for(uint64_t b = 0; b < n || runs.empty(); b += len){
+        interval_run iv;
+        iv.begin = b;
+        iv.end = (n - b > len) ? b + len : n;
+        iv.warmup = (b < ip.warmup) ? b : ip.warmup;
+        iv.start_cycle = iv.end_cycle = 0;
+        iv.head_split = iv.tail_split = 0;
+        iv.error = 0;
+        runs.push_back(iv);
+    }
+    if(jobs == 0){
+        jobs = std::thread::hardware_concurrency();
+    }
+
+    //simulate every interval in pending, then re-estimate; repeat while over the tolerance
+    std::vector<size_t> pending;
+    for(size_t i = 0; i < runs.size(); i++){
+        pending.push_back(i);
+    }
+    while(!pending.empty()){
+        std::atomic<size_t> next(0);
+        std::vector<std::thread> workers;
+        unsigned threads = (jobs == 0 || jobs > pending.size()) ? pending.size() : jobs;
+        for(unsigned t = 0; t < threads; t++){
+            workers.push_back(std::thread([&](){
+                for(size_t p = next++; p < pending.size(); p = next++){
+                    size_t i = pending[p];
+                    Run_Interval(img, params, ops, check, i + 1 == runs.size(), runs[i]);
+                }
+            }));
+        }
+        for(unsigned t = 0; t < workers.size(); t++){
+            workers[t].join();
+        }
+
+        res.num_cycles = 0;
+        res.error = 0;
+        for(size_t i = 0; i < runs.size(); i++){
+            res.num_cycles += runs[i].end_cycle - runs[i].start_cycle;
+            runs[i].error = (i == 0 || runs[i].warmup == runs[i].begin) ? 0 : boundary_error(runs[i - 1], runs[i]);
+            res.error += runs[i].error;
+        }
+        pending.clear();
+        if(res.error <= ip.tolerance / 100 * res.num_cycles){
+            break;
+        }
+        for(size_t i = 0; i < runs.size(); i++){
+            if(runs[i].error != 0){
+                runs[i].warmup = (runs[i].begin / 2 < runs[i].warmup) ? runs[i].begin : 2 * runs[i].warmup;
+                pending.push_back(i);
+            }
+        }
+    }
+
+    res.num_instr = n;
+    res.num_intervals = runs.size();
+    res.min_warmup = res.max_warmup = (runs.size() > 1) ? runs[1].warmup : 0;
+    for(size_t i = 1; i < runs.size(); i++){
+        if(runs[i].warmup < res.min_warmup){
+            res.min_warmup = runs[i].warmup;
+        }
+        if(runs[i].warmup > res.max_warmup){
+            res.max_warmup = runs[i].warmup;
+        }
+    }
+}
+
+//summary block of an interval-parallel run, followed by the error estimate
+inline void Print_Interval_Summary(FILE *out, const proc_params &params, const interval_result &res, const char *trace_file){
+    Print_Summary(out, params, res.num_instr, res.num_cycles, trace_file);
+    fprintf(out, "# Estimated Cycle Error        = +/-%.0f (%.3f%%)\n", res.error,
+            res.num_cycles != 0 ? 100 * res.error / res.num_cycles : 0.0);
+    fprintf(out, "# Intervals                    = %lu (warmup %lu to %lu instr.)\n", res.num_intervals,
+            res.min_warmup, res.max_warmup);
+}
+
+#endif
@@ -1,9 +1,21 @@
 #include <cstdio>
+#include <climits>
 #include <cstdlib>
+#include <cstring>
 #include <list>
+#include <string>
 #include <vector>
+#include <unistd.h>
 
 #include "sim_proc.h"
+#include "sim_sweep.h"
+#include "sim_batch.h"
+#include "sim_sample.h"
+#include "sim_interval.h"
+#include "sim_search.h"
+#include "sim_checkpoint.h"
+#include "sim_cache.h"
+#include "sim_telemetry.h"
 
 /*  argc holds the number of command line arguments
     argv[] holds the commands themselves
@@ -15,99 +27,530 @@
     argv[1] = "256"
     argv[2] = "32"
     ... and so on
+
+    Options come before the four positional arguments:-
+    --sweep      rob/iq/width arguments are lists, see sim_sweep.h
+    --batch      with --sweep: simulate every configuration in one streaming pass over the trace, see sim_batch.h
+    --search[=P[:S]]  like --sweep, but only simulate what an IPC/cost Pareto frontier within S% of the exact one
+                 needs, see sim_search.h
+    --cost=R,Q,W cost per ROB entry, IQ entry and unit of width for --search (default 1,4,64)
+    --jobs=N     worker threads for --sweep, --search and --parallel (default: all cores)
+    --timing=F   per-instruction timing output: text (default), binary or none
+    --out=FILE   write per-instruction timing to FILE instead of stdout
+                 (a binary log also gets a seek index, FILE.idx, for the scope viewer)
+    --sample=P[:U[:W]]  sampled simulation, see sim_sample.h; no per-instruction output
+    --parallel=N[:W[:T]]  simulate N intervals of the trace in parallel, see sim_interval.h; no per-instruction output
+    --checkpoint=FILE --checkpoint-every=N
+                 save the simulator state to FILE.<cycle> every N cycles, see sim_checkpoint.h
+    --fu-config=FILE  op class latencies and FU counts, see Op_Table in sim_proc.h
+    --stats=FILE per-stage stall counters and ROB/IQ/EX occupancy histograms, JSON (CSV for FILE.csv)
+    --clock=C    event (default): skip cycles in which nothing can move; cycle: step every cycle
+    --resume=FILE    continue from a checkpoint (--out is cut back to where the checkpoint left it)
+    --cache=DIR  reuse the results (and timing output) of identical earlier runs, see sim_cache.h
+    --telemetry=DEST  periodic progress snapshots to a file or unix:SOCKET, see sim_telemetry.h
+    --telemetry-period=MS  time between snapshots (default 1000)
 */
 
+//open an output file for writing from offset on, anything past it (from an interrupted run) is cut off
+FILE *Open_Output(const char *name, unsigned long long offset)
+{
+    if (offset == 0)
+        return fopen(name, "wb");
+    FILE *fp = fopen(name, "r+b");
+    if (fp == NULL || ftruncate(fileno(fp), offset) != 0 || fseek(fp, 0, SEEK_END) != 0)
+        return NULL;
+    return fp;
+}
+
 int main (int argc, char* argv[])
 {
-    FILE *FP;               // File handler
+    Trace_Reader *trace;    // Trace reader (text or binary trace)
     char *trace_file;       // Variable that holds trace file name;
     proc_params params;       // look at sim_bp.h header file for the the definition of struct proc_params
-    
-    if (argc != 5)
+    bool sweep = false, batch = false, sample = false, parallel = false, search = false;
+    sample_params sampling;
+    search_params searching;
+    searching.cost_rob = 1;
+    searching.cost_iq = 4;
+    searching.cost_width = 64;
+    interval_params intervals;
+    const char *checkpoint_file = NULL, *resume_file = NULL, *stats_file = NULL, *cache_dir = NULL;
+    const char *telemetry_dest = NULL;
+    unsigned long telemetry_period = TELEMETRY_PERIOD;
+    unsigned long checkpoint_every = 0;
+    bool event_clock = true;
+    Op_Table ops;
+    unsigned jobs = 0;
+    timing_format timing = TIMING_TEXT;
+    bool timing_set = false;
+    const char *timing_file = NULL;
+    int argi = 1;
+
+    while (argi < argc && strncmp(argv[argi], "--", 2) == 0)
+    {
+        if (strcmp(argv[argi], "--sweep") == 0)
+            sweep = true;
+        else if (strcmp(argv[argi], "--batch") == 0)
+            batch = true;
+        else if (strncmp(argv[argi], "--jobs=", 7) == 0)
+            jobs = strtoul(argv[argi] + 7, NULL, 10);
+        else if (strncmp(argv[argi], "--timing=", 9) == 0)
+        {
+            timing_set = true;
+            if (strcmp(argv[argi] + 9, "text") == 0)
+                timing = TIMING_TEXT;
+            else if (strcmp(argv[argi] + 9, "binary") == 0)
+                timing = TIMING_BINARY;
+            else if (strcmp(argv[argi] + 9, "none") == 0)
+                timing = TIMING_NONE;
+            else
+            {
+                printf("Error: Unknown option %s\n", argv[argi]);
+                exit(EXIT_FAILURE);
+            }
+        }
+        else if (strncmp(argv[argi], "--out=", 6) == 0)
+            timing_file = argv[argi] + 6;
+        else if (strncmp(argv[argi], "--checkpoint=", 13) == 0)
+            checkpoint_file = argv[argi] + 13;
+        else if (strncmp(argv[argi], "--checkpoint-every=", 19) == 0)
+            checkpoint_every = strtoul(argv[argi] + 19, NULL, 10);
+        else if (strncmp(argv[argi], "--fu-config=", 12) == 0)
+        {
+            if (!ops.load(argv[argi] + 12))
+                exit(EXIT_FAILURE);
+        }
+        else if (strncmp(argv[argi], "--stats=", 8) == 0)
+            stats_file = argv[argi] + 8;
+        else if (strcmp(argv[argi], "--clock=event") == 0)
+            event_clock = true;
+        else if (strcmp(argv[argi], "--clock=cycle") == 0)
+            event_clock = false;
+        else if (strncmp(argv[argi], "--resume=", 9) == 0)
+            resume_file = argv[argi] + 9;
+        else if (strncmp(argv[argi], "--cache=", 8) == 0)
+            cache_dir = argv[argi] + 8;
+        else if (strncmp(argv[argi], "--telemetry=", 12) == 0)
+            telemetry_dest = argv[argi] + 12;
+        else if (strncmp(argv[argi], "--telemetry-period=", 19) == 0)
+        {
+            char *q;
+            telemetry_period = strtoul(argv[argi] + 19, &q, 10);
+            //a period of 0 would have the reporter spin
+            if (*q != '\0' || telemetry_period == 0)
+            {
+                printf("Error: Malformed telemetry period %s\n", argv[argi] + 19);
+                exit(EXIT_FAILURE);
+            }
+        }
+        else if (strncmp(argv[argi], "--sample=", 9) == 0)
+        {
+            sample = true;
+            if (!parse_sample_params(argv[argi] + 9, sampling))
+            {
+                printf("Error: Malformed sampling schedule %s\n", argv[argi] + 9);
+                exit(EXIT_FAILURE);
+            }
+        }
+        else if (strncmp(argv[argi], "--search", 8) == 0)
+        {
+            search = true;
+            if (!parse_search_params(argv[argi] + 8, searching))
+            {
+                printf("Error: Malformed search option %s\n", argv[argi]);
+                exit(EXIT_FAILURE);
+            }
+        }
+        else if (strncmp(argv[argi], "--cost=", 7) == 0)
+        {
+            if (!parse_search_cost(argv[argi] + 7, searching))
+            {
+                printf("Error: Malformed cost weights %s\n", argv[argi] + 7);
+                exit(EXIT_FAILURE);
+            }
+        }
+        else if (strncmp(argv[argi], "--parallel=", 11) == 0)
+        {
+            parallel = true;
+            if (!parse_interval_params(argv[argi] + 11, intervals))
+            {
+                printf("Error: Malformed interval schedule %s\n", argv[argi] + 11);
+                exit(EXIT_FAILURE);
+            }
+        }
+        else
+        {
+            printf("Error: Unknown option %s\n", argv[argi]);
+            exit(EXIT_FAILURE);
+        }
+        argi++;
+    }
+
+    if (argc - argi != 4)
+    {
+        printf("Error: Wrong number of inputs:%d\n", argc-argi);
+        exit(EXIT_FAILURE);
+    }
+
+    trace_file          = argv[argi+3];
+
+    if (sweep + sample + parallel + search > 1)
+    {
+        printf("Error: Only one of --sweep, --search, --sample and --parallel can be used\n");
+        exit(EXIT_FAILURE);
+    }
+    if (batch && !sweep)
+    {
+        printf("Error: --batch goes with --sweep\n");
+        exit(EXIT_FAILURE);
+    }
+    if ((sweep || search || sample || parallel) && (timing_set || timing_file != NULL))
     {
-        printf("Error: Wrong number of inputs:%d\n", argc-1);
+        printf("Error: --timing and --out can't be combined with --sweep, --search, --sample or --parallel\n");
         exit(EXIT_FAILURE);
     }
-    
-    params.rob_size     = strtoul(argv[1], NULL, 10);
-    params.iq_size      = strtoul(argv[2], NULL, 10);
-    params.width        = strtoul(argv[3], NULL, 10);
-    num_instr           = 0;
-    num_cycles          = 0;
-    trace_file          = argv[4];
-
-    //**********************
-    //Pipeline Registers
-    std::vector<Instruction_Bundle> decode_bundle;
-    std::vector<Instruction_Bundle> rename_bundle;
-    std::vector<Instruction_Bundle> regRead_bundle;
-    std::vector<Instruction_Bundle> dispatch_bundle;
-    std::vector<Instruction_Bundle> writeback_bundle;
-    std::vector<Instruction_Bundle> retire_bundle;
-    std::vector<Instruction_Bundle> execute_list;
-    //**********************
-    ROB ROB_table;
-    Issue_Queue issueQueue;
-    RMT RMT_table;
-
-    //**********************
-    //Re-Order Buffer (ROB)
-    ROB_table.head = ROB_table.tail = 3; //rob3
-    ROB_table.rob_size = params.rob_size;
-    ROB_ENTRY temp;
-    for(int i = 0; i < params.rob_size; i++){
-        ROB_table.table.push_back(temp);
-    }
-    //Issue_Queue issueQueue;
-    issueQueue.iq_size = params.iq_size;
-
-    //RMT
-    for(int i = 0; i < 67; i++){
-        RMT_table.reg_list[i].rob_tag = 0;
-        RMT_table.reg_list[i].valid = false;
-    }
-
-    // Open trace_file in read mode
-    FP = fopen(trace_file, "r");
-    if(FP == NULL)
+    if ((checkpoint_file != NULL) != (checkpoint_every != 0))
+    {
+        printf("Error: --checkpoint and --checkpoint-every go together\n");
+        exit(EXIT_FAILURE);
+    }
+    if ((sweep || search || sample || parallel) && (checkpoint_file != NULL || resume_file != NULL || stats_file != NULL
+            || telemetry_dest != NULL))
+    {
+        printf("Error: Checkpoints, --stats and --telemetry can't be combined with --sweep, --search, --sample or --parallel\n");
+        exit(EXIT_FAILURE);
+    }
+    if (cache_dir != NULL && (sample || parallel || search || checkpoint_file != NULL || resume_file != NULL || stats_file != NULL))
+    {
+        printf("Error: --cache can't be combined with --sample, --parallel, --search, checkpoints or --stats\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Runs are looked up in the cache by a hash of the trace's contents
+    Result_Cache cache;
+    uint64_t trace_hash = 0;
+    if (cache_dir != NULL)
+    {
+        if (!cache.open(cache_dir))
+        {
+            printf("Error: Unable to use cache directory %s\n", cache_dir);
+            exit(EXIT_FAILURE);
+        }
+        if (!cache.hash_file(trace_file, trace_hash))
+        {
+            printf("Error: Unable to open file %s\n", trace_file);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (sweep || search)
+    {
+        std::vector<unsigned long> rob_sizes, iq_sizes, widths;
+        if (!parse_param_list(argv[argi], rob_sizes) || !parse_param_list(argv[argi+1], iq_sizes)
+                || !parse_param_list(argv[argi+2], widths))
+        {
+            printf("Error: Malformed sweep list\n");
+            exit(EXIT_FAILURE);
+        }
+        // A batched sweep streams the trace instead of decoding it whole
+        Trace_Image img;
+        if (!batch && !load_trace_image(trace_file, img))
+        {
+            printf("Error: Unable to open file %s\n", trace_file);
+            exit(EXIT_FAILURE);
+        }
+        if (search)
+        {
+            Design_Search ds(img, ops, searching, jobs, rob_sizes, iq_sizes, widths);
+            search_result res;
+            ds.run(res);
+            Print_Search(stdout, res, trace_file);
+            return 0;
+        }
+        // Configurations that would never drain are left out and counted, as --search does
+        std::vector<proc_params> configs;
+        unsigned long unrunnable = 0;
+        for (size_t r = 0; r < rob_sizes.size(); r++)
+            for (size_t q = 0; q < iq_sizes.size(); q++)
+                for (size_t w = 0; w < widths.size(); w++)
+                {
+                    params.rob_size = rob_sizes[r];
+                    params.iq_size  = iq_sizes[q];
+                    params.width    = widths[w];
+                    if (runnable_config(params))
+                        configs.push_back(params);
+                    else
+                        unrunnable++;
+                }
+        std::vector<sweep_result> results(configs.size());
+        std::vector<proc_params> missed;
+        std::vector<size_t> missed_at;
+        for (size_t i = 0; i < configs.size(); i++)
+        {
+            results[i].params = configs[i];
+            if (cache_dir != NULL)
+            {
+                cache_key key;
+                cache_entry entry;
+                cache.make_key(trace_hash, configs[i], ops, key);
+                if (cache.lookup(key, false, entry))
+                {
+                    results[i].num_instr = entry.num_instr;
+                    results[i].num_cycles = entry.num_cycles;
+                    continue;
+                }
+            }
+            missed.push_back(configs[i]);
+            missed_at.push_back(i);
+        }
+        std::vector<sweep_result> simulated;
+        if (!missed.empty() && batch)
+        {
+            Trace_Reader *trace = open_trace(trace_file);
+            if (trace == NULL)
+            {
+                printf("Error: Unable to open file %s\n", trace_file);
+                exit(EXIT_FAILURE);
+            }
+            Run_Batch(*trace, missed, ops, jobs, simulated);
+            delete trace;
+        }
+        else if (!missed.empty())
+            Run_Sweep(img, missed, ops, jobs, simulated);
+        for (size_t i = 0; i < simulated.size(); i++)
+        {
+            results[missed_at[i]] = simulated[i];
+            if (cache_dir == NULL)
+                continue;
+            cache_key key;
+            cache.make_key(trace_hash, simulated[i].params, ops, key);
+            if (!cache.store(key, simulated[i].num_instr, simulated[i].num_cycles))
+            {
+                printf("Error: Unable to write to cache directory %s\n", cache_dir);
+                exit(EXIT_FAILURE);
+            }
+        }
+        for (size_t i = 0; i < results.size(); i++)
+            Print_Summary(stdout, results[i].params, results[i].num_instr, results[i].num_cycles, trace_file);
+        if (unrunnable != 0)
+            printf("# Unrunnable (IQ/ROB < WIDTH)  = %lu\n", unrunnable);
+        return 0;
+    }
+
+    params.rob_size     = strtoul(argv[argi], NULL, 10);
+    params.iq_size      = strtoul(argv[argi+1], NULL, 10);
+    params.width        = strtoul(argv[argi+2], NULL, 10);
+    if (params.width == 0 || !runnable_config(params))
+    {
+        printf("Error: IQ_SIZE and ROB_SIZE must hold a bundle of WIDTH instr.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (parallel)
+    {
+        Trace_Image img;
+        if (!load_trace_image(trace_file, img))
+        {
+            printf("Error: Unable to open file %s\n", trace_file);
+            exit(EXIT_FAILURE);
+        }
+        interval_result res;
+        Run_Intervals(img, params, ops, intervals, jobs, res);
+        Print_Interval_Summary(stdout, params, res, trace_file);
+        return 0;
+    }
+
+    // Open trace_file in read mode, binary traces are detected by their magic number
+    trace = open_trace(trace_file);
+    if(trace == NULL)
     {
         // Throw error and exit if fopen() failed
         printf("Error: Unable to open file %s\n", trace_file);
         exit(EXIT_FAILURE);
     }
 
-    bool EOF_flag = false;
-    bool pipeline_empty;
-    int seq = 0;
-    do {
-        //true denotes current stage is empty or ready to accept new bundle
-        //false denotes current stage has a bundle or can't accept new bundle
-        Retire(params.width, ROB_table, retire_bundle, regRead_bundle, RMT_table, seq);
-        Writeback(writeback_bundle, ROB_table, retire_bundle);
-        Execute(execute_list, writeback_bundle, issueQueue, dispatch_bundle, regRead_bundle);
-        Issue(params.width, execute_list, issueQueue);
-        Dispatch(dispatch_bundle, issueQueue);
-        RegRead(ROB_table, regRead_bundle, dispatch_bundle);
-        Rename(RMT_table, ROB_table, rename_bundle, regRead_bundle);
-        Decode(rename_bundle, decode_bundle);
-        Fetch(FP, params.width, decode_bundle, EOF_flag);
-        pipeline_empty = decode_bundle.empty() && rename_bundle.empty() && regRead_bundle.empty()
-                && dispatch_bundle.empty() && issueQueue.IQ.empty() && ROB_table.head == ROB_table.tail && execute_list.empty()
-                && writeback_bundle.empty();
-    } while (Advance_Cycle(EOF_flag, pipeline_empty));
-
-
-
-    printf("# === Simulator Command =========\n");
-    printf("# ./sim %lu %lu %lu %s\n", params.rob_size, params.iq_size, params.width, trace_file);
-    printf("# === Processor Configuration ===\n");
-    printf("# ROB_SIZE = %lu\n", params.rob_size);
-    printf("# IQ_SIZE  = %lu\n", params.iq_size);
-    printf("# WIDTH    = %lu\n", params.width);
-    printf("# === Simulation Results ========\n");
-    printf("# Dynamic Instruction Count    = %d\n", num_instr);
-    printf("# Cycles                       = %d\n", num_cycles);
-    printf("# Instructions Per Cycle (IPC) = %2.2f\n", float(num_instr)/float(num_cycles));
+    if (sample)
+    {
+        sample_result res;
+        Run_Sampled(params, ops, sampling, *trace, res);
+        if (res.num_samples == 0)
+        {
+            printf("Error: Trace %s is shorter than one sampling period\n", trace_file);
+            exit(EXIT_FAILURE);
+        }
+        Print_Sampled_Summary(stdout, params, sampling, res, trace_file);
+        delete trace;
+        return 0;
+    }
+
+    // Per-instruction timing goes to stdout unless redirected; binary output needs a file
+    FILE *timing_fp = stdout;
+    if (timing == TIMING_BINARY && timing_file == NULL)
+    {
+        printf("Error: --timing=binary needs --out=FILE\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // A cached run prints its summary, and writes its timing output from the stored log, without simulating
+    cache_key key;
+    std::string cache_log;
+    if (cache_dir != NULL)
+    {
+        cache_entry entry;
+        cache.make_key(trace_hash, params, ops, key);
+        cache_log = cache.path(key) + ".tlog";
+        if (cache.lookup(key, timing != TIMING_NONE, entry))
+        {
+            if (timing != TIMING_NONE && !write_cached_timing(cache_log, timing, timing_file))
+            {
+                printf("Error: Unable to write timing output from cache %s\n", cache_log.c_str());
+                exit(EXIT_FAILURE);
+            }
+            Print_Summary(stdout, params, entry.num_instr, entry.num_cycles, trace_file);
+            delete trace;
+            return 0;
+        }
+    }
+
+    // A resumed run restores the state, skips the trace to where it was and continues the timing output
+    Sim_State sim(params);
+    sim.ops = ops;
+    Sim_Stats stats(params.rob_size, params.iq_size);
+    if (stats_file != NULL)
+        sim.stats = &stats;
+    checkpoint_header ckpt;
+    memset(&ckpt, 0, sizeof(ckpt));
+    if (resume_file != NULL)
+    {
+        if (!Load_Checkpoint(resume_file, sim, ckpt))
+        {
+            printf("Error: %s is not a checkpoint of this configuration\n", resume_file);
+            exit(EXIT_FAILURE);
+        }
+        if (skip_trace(*trace, ckpt.trace_offset) != ckpt.trace_offset)
+        {
+            printf("Error: Trace %s is shorter than checkpoint %s\n", trace_file, resume_file);
+            exit(EXIT_FAILURE);
+        }
+        if (timing == TIMING_BINARY && ckpt.timing_offset == 0)
+        {
+            printf("Error: Checkpoint %s has no binary timing log to continue\n", resume_file);
+            exit(EXIT_FAILURE);
+        }
+    }
+    // With a cache the run writes a binary log into it, the requested timing output is made from that
+    std::string cache_tmp;
+    const char *log_file = timing_file;
+    timing_format log_format = timing;
+    if (cache_dir != NULL && timing != TIMING_NONE)
+    {
+        cache_tmp = Result_Cache::temp_name(cache_log);
+        log_file = cache_tmp.c_str();
+        log_format = TIMING_BINARY;
+    }
+    if (log_file != NULL && (timing_fp = Open_Output(log_file, ckpt.timing_offset)) == NULL)
+    {
+        printf("Error: Unable to open file %s\n", log_file);
+        exit(EXIT_FAILURE);
+    }
+    FILE *index_fp = NULL;
+    std::string index_file;
+    if (log_format == TIMING_BINARY)
+    {
+        index_file = std::string(log_file) + ".idx";
+        if ((index_fp = Open_Output(index_file.c_str(), ckpt.index_offset)) == NULL)
+        {
+            printf("Error: Unable to open file %s\n", index_file.c_str());
+            exit(EXIT_FAILURE);
+        }
+    }
+    Timing_Writer writer(timing_fp, log_format, index_fp, ckpt.timing_offset, ckpt.timing_prev_fetch);
+
+    sim.timing_out = (timing == TIMING_NONE) ? NULL : &writer;
+    sim.event_clock = event_clock;
+    Telemetry telemetry;
+    if (telemetry_dest != NULL)
+    {
+        if (!telemetry.open(telemetry_dest))
+        {
+            printf("Error: Unable to open telemetry sink %s\n", telemetry_dest);
+            exit(EXIT_FAILURE);
+        }
+        telemetry.period_ms = telemetry_period;
+        telemetry.trace_len = trace_length(trace);
+        telemetry.begin(sim);
+    }
+    if (checkpoint_file == NULL && telemetry_dest == NULL)
+        Simulate(sim, *trace);
+    else
+    {
+        // the event clock can jump over a multiple of N, the checkpoint is then taken just after it
+        unsigned long next_checkpoint = (checkpoint_file == NULL) ? ULONG_MAX
+                : (sim.num_cycles / checkpoint_every + 1) * checkpoint_every;
+        step_fn step = Select_Core(sim);
+        while (step(sim, *trace))
+        {
+            if (telemetry_dest != NULL)
+                telemetry.tick(sim);
+            if ((unsigned long)sim.num_cycles < next_checkpoint)
+                continue;
+            next_checkpoint = (sim.num_cycles / checkpoint_every + 1) * checkpoint_every;
+            std::string name = std::string(checkpoint_file) + "." + std::to_string(sim.num_cycles);
+            if (!Save_Checkpoint(name.c_str(), sim, sim.timing_out))
+            {
+                printf("Error: Unable to write checkpoint %s\n", name.c_str());
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+    telemetry.finish(&sim);
+    writer.flush();
+    // the writer flushes again when it goes out of scope, the files are closed by then
+    writer.FP = writer.index = NULL;
+    if (timing_fp != stdout)
+        fclose(timing_fp);
+    if (index_fp != NULL)
+        fclose(index_fp);
+
+    // the log and its index go into place before the summary that points to them
+    if (cache_dir != NULL)
+    {
+        if (!cache_tmp.empty() && (rename(index_file.c_str(), (cache_log + ".idx").c_str()) != 0
+                || !Result_Cache::commit(cache_log)))
+        {
+            printf("Error: Unable to write to cache directory %s\n", cache_dir);
+            exit(EXIT_FAILURE);
+        }
+        if (!cache.store(key, sim.num_instr, sim.num_cycles))
+        {
+            printf("Error: Unable to write to cache directory %s\n", cache_dir);
+            exit(EXIT_FAILURE);
+        }
+        if (!cache_tmp.empty() && !write_cached_timing(cache_log, timing, timing_file))
+        {
+            printf("Error: Unable to write timing output from cache %s\n", cache_log.c_str());
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    Print_Summary(stdout, params, sim.num_instr, sim.num_cycles, trace_file);
+
+    if (stats_file != NULL)
+    {
+        FILE *stats_fp = fopen(stats_file, "w");
+        size_t len = strlen(stats_file);
+        if (stats_fp == NULL)
+        {
+            printf("Error: Unable to open file %s\n", stats_file);
+            exit(EXIT_FAILURE);
+        }
+        if (len >= 4 && strcmp(stats_file + len - 4, ".csv") == 0)
+            stats.write_csv(stats_fp, sim.num_instr, sim.num_cycles);
+        else
+            stats.write_json(stats_fp, sim.num_instr, sim.num_cycles);
+        fclose(stats_fp);
+    }
 
+    delete trace;
     return 0;
 }
@@ -1,8 +1,18 @@
 #ifndef SIM_PROC_H
 #define SIM_PROC_H
 
+#include <cstdio>
+#include <cstring>
 #include <vector>
 #include <algorithm>
+#include <stdint.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "trace_io.h"
+#include "timing_log.h"
+#include "sim_stats.h"
 
 typedef struct proc_params{
     unsigned long int rob_size;
@@ -10,23 +20,107 @@ typedef struct proc_params{
     unsigned long int width;
 }proc_params;
 
+//Op Classes------------------------------------------------------------------------------------------------------------
+//
+//execute latency and number of functional units per op_type; the default is the original
+//machine: type 0 takes 1 cycle, type 1 takes 2 and every other type 5, with unlimited FUs.
+//a config file (--fu-config=FILE) overrides entries and adds op classes, one per line:
+//  <op_type> <latency> [<units>]     units = FUs of that class (pipelined), 0 = unlimited
+//'#' starts a comment
+#define MAX_OP_TYPES    64
+
+class Op_Table{
+public:
+    int latency[MAX_OP_TYPES];
+    int units[MAX_OP_TYPES];
+    bool limited;       //some class has a finite number of FUs
+    bool custom;        //differs from the default machine
+
+    Op_Table() : limited(false), custom(false){
+        for(int i = 0; i < MAX_OP_TYPES; i++){
+            latency[i] = default_latency(i);
+            units[i] = 0;
+        }
+    }
+    static int default_latency(int op){
+        return (op == 0) ? 1 : ((op == 1) ? 2 : 5);
+    }
+    int get_latency(int op) const {
+        return (op >= 0 && op < MAX_OP_TYPES) ? latency[op] : 5;
+    }
+    int get_class(int op) const {
+        return (op >= 0 && op < MAX_OP_TYPES) ? op : MAX_OP_TYPES - 1;
+    }
+
+    //read a config file, returns false (after printing why) on a malformed one
+    bool load(const char *file){
+        FILE *fp = fopen(file, "r");
+        if(fp == NULL){
+            printf("Error: Unable to open file %s\n", file);
+            return false;
+        }
+        char line[256];
+        for(int n = 1; fgets(line, sizeof(line), fp) != NULL; n++){
+            char *hash = strchr(line, '#');
+            if(hash != NULL){
+                *hash = '\0';
+            }
+            int op, lat, fu = 0;
+            int got = sscanf(line, "%d %d %d", &op, &lat, &fu);
+            if(got <= 0){
+                continue;
+            }
+            if(got < 2 || op < 0 || op >= MAX_OP_TYPES || lat < 1 || fu < 0){
+                printf("Error: %s:%d: expected <op_type 0-%d> <latency >= 1> [<units>]\n", file, n, MAX_OP_TYPES - 1);
+                fclose(fp);
+                return false;
+            }
+            latency[op] = lat;
+            units[op] = fu;
+            limited = limited || fu != 0;
+            custom = custom || lat != default_latency(op) || fu != 0;
+        }
+        fclose(fp);
+        return true;
+    }
+};
+
 //Additional Data Structures--------------------------------------------------------------------------------------------
 
 //rep instr. bundle
 //maintain timer encoding
 class Instruction_Bundle{
 public:
-    int op_type, dst, src1, src2, latency, age_in_iss;
+    int op_type, dst, src1, src2, latency;
     int src1_non_rob, src2_non_rob, dst_non_rob;
-    unsigned long pc;
+    uint64_t pc;
     bool rs1_rob, rs2_rob, rs1_rdy, rs2_rdy;
-    int FE_begin, DE_begin, RN_begin, RR_begin, DI_begin, IS_begin, EX_begin, WB_begin, RT_begin;
+    uint64_t FE_begin, DE_begin, RN_begin, RR_begin, DI_begin, IS_begin, EX_begin, WB_begin, RT_begin;
     int FE_cycles, DE_cycles, RN_cycles, RR_cycles, DI_cycles, IS_cycles, EX_cycles, WB_cycles, RT_cycles;
 };
 
-struct comparator{
-    inline bool operator() (const Instruction_Bundle &temp1, const Instruction_Bundle &temp2){
-        return (temp1.age_in_iss < temp2.age_in_iss);
+//in-flight instr. are referred to by their slot in the Sim_State slab
+typedef uint32_t instr_idx;
+
+//pipeline latch, a fixed-capacity list of slab indices
+//storage is sized once; swapping two latches exchanges their buffers
+class Latch{
+public:
+    std::vector<instr_idx> idx;
+    unsigned long count;
+    void init(unsigned long capacity){
+        idx.assign(capacity, 0);
+        count = 0;
+    }
+    bool empty() const { return count == 0; }
+    unsigned long size() const { return count; }
+    instr_idx &operator[](unsigned long i){ return idx[i]; }
+    void push_back(instr_idx i){ idx[count++] = i; }
+    void clear(){ count = 0; }
+    void resize(unsigned long n){ count = n; }
+    void swap(Latch &other){
+        idx.swap(other.idx);
+        std::swap(count, other.count);
     }
 };
 
@@ -44,105 +138,292 @@ public:
 
 };
 //Re-Order Buffer
+//each entry indexes the record of the instr. it holds and names the arch. register
+//it maps in the RMT (dest), so retiring the head is constant-time
+//occupancy is counted explicitly: no pc/dest value of an entry is reserved to mean "free"
 class ROB_ENTRY{
 public:
-    unsigned int pc;
+    uint64_t pc;
     int dest;
     bool rdy;
-    ROB_ENTRY() : pc(0), dest(0), rdy(false){}
+    instr_idx instr;
+    ROB_ENTRY() : pc(0), dest(0), rdy(false), instr(0){}
     void clr(){pc = 0; dest = 0; rdy = false;}
-    bool empty(){
-        return pc == 0 && dest == 0 && !rdy;
-    }
 };
 class ROB{
 public:
     int head, tail;
     unsigned long rob_size;
+    unsigned long count;        //occupied entries, head == tail is both empty and full
     std::vector<ROB_ENTRY> table;
     unsigned long space_available(){
-        unsigned long avail_entries;
-        //some entries in ROB, no 'wrap-around'
-        if(tail < head){
-            avail_entries = head - tail;
+        return rob_size - count;
+    };
+};
+
+
+//Issue Queue
+//fixed-capacity structure-of-arrays:
+//  - per slot, the ROB tags the entry still waits on (-1 once a source is ready, or for a free slot),
+//    compared against a completing tag 4 slots at a time
+//  - every IQ entry owns a ROB entry and the ROB is in program order, so ready entries are kept in a
+//    bitmask indexed by ROB tag; the oldest ready entries are the first set bits walking from the ROB head
+class Issue_Queue{
+public:
+    unsigned long iq_size;
+    unsigned long count;                    //occupied slots
+    unsigned long num_slots;                //iq_size rounded up to the SIMD width
+    std::vector<int32_t> src1_tag, src2_tag;
+    std::vector<int> rob_tag;               //slot -> ROB tag
+    std::vector<int> slot_of;               //ROB tag -> slot
+    std::vector<instr_idx> entry;           //slot -> instr.
+    std::vector<int> free_slots;
+    std::vector<uint64_t> ready;            //ROB tag -> entry in IQ with both sources ready
+    std::vector<int> selected;              //ROB tags picked by oldest_ready()
+
+    void init(unsigned long size, unsigned long rob_size){
+        iq_size = size;
+        count = 0;
+        num_slots = (size + 3) & ~3UL;
+        src1_tag.assign(num_slots, -1);
+        src2_tag.assign(num_slots, -1);
+        rob_tag.assign(num_slots, 0);
+        slot_of.assign(rob_size, 0);
+        entry.resize(num_slots);
+        free_slots.clear();
+        for(unsigned long i = size; i > 0; i--){
+            free_slots.push_back(i - 1);
         }
-        //some entries in ROB, 'wrap-around' occured at some point
-        else if(head < tail){
-            avail_entries = rob_size - (tail - head);
+        ready.assign((rob_size + 63) / 64, 0);
+    }
+    bool empty(){ return count == 0; }
+    unsigned long space_available(){ return iq_size - count; }
+
+    //place a renamed instr. (dst holds its ROB tag) in a free slot
+    void insert(const Instruction_Bundle &instr, instr_idx idx){
+        int slot = free_slots.back();
+        free_slots.pop_back();
+        count++;
+        entry[slot] = idx;
+        rob_tag[slot] = instr.dst;
+        slot_of[instr.dst] = slot;
+        src1_tag[slot] = instr.rs1_rdy ? -1 : instr.src1;
+        src2_tag[slot] = instr.rs2_rdy ? -1 : instr.src2;
+        if(instr.rs1_rdy && instr.rs2_rdy){
+            ready[instr.dst >> 6] |= 1ULL << (instr.dst & 63);
         }
-        //first entries, full rob, or near full rob
-        else{
-            if(tail < (rob_size - 1)){
-                if(table[tail+1].empty()){
-                    avail_entries = rob_size;
-                }
-                else{
-                    avail_entries = 0;
-                }
+    }
+
+    //remove the entry of ROB tag, returns its instr.
+    instr_idx remove(int tag){
+        int slot = slot_of[tag];
+        ready[tag >> 6] &= ~(1ULL << (tag & 63));
+        src1_tag[slot] = src2_tag[slot] = -1;
+        free_slots.push_back(slot);
+        count--;
+        return entry[slot];
+    }
+
+    //mark sources produced by ROB tag as ready
+    //slots is num_slots, a compile-time constant in a specialized core
+    void wakeup(int tag, unsigned long slots){
+        for(unsigned long slot = 0; slot < slots; slot += 4){
+#ifdef __SSE2__
+            __m128i t = _mm_set1_epi32(tag);
+            __m128i s1 = _mm_loadu_si128((const __m128i *)&src1_tag[slot]);
+            __m128i s2 = _mm_loadu_si128((const __m128i *)&src2_tag[slot]);
+            __m128i eq1 = _mm_cmpeq_epi32(s1, t);
+            __m128i eq2 = _mm_cmpeq_epi32(s2, t);
+            int hit = _mm_movemask_ps(_mm_castsi128_ps(_mm_or_si128(eq1, eq2)));
+            if(hit == 0){
+                continue;
             }
-            else{
-                if(table[tail-1].empty()){
-                    avail_entries = rob_size;
-                }
-                else{
-                    avail_entries = 0;
+            //matching lanes become -1
+            s1 = _mm_or_si128(s1, eq1);
+            s2 = _mm_or_si128(s2, eq2);
+            _mm_storeu_si128((__m128i *)&src1_tag[slot], s1);
+            _mm_storeu_si128((__m128i *)&src2_tag[slot], s2);
+            __m128i none = _mm_set1_epi32(-1);
+            int rdy = hit & _mm_movemask_ps(_mm_castsi128_ps(_mm_and_si128(_mm_cmpeq_epi32(s1, none),
+                    _mm_cmpeq_epi32(s2, none))));
+            for(; rdy != 0; rdy &= rdy - 1){
+                int r = rob_tag[slot + __builtin_ctz(rdy)];
+                ready[r >> 6] |= 1ULL << (r & 63);
+            }
+#else
+            for(unsigned long i = slot; i < slot + 4; i++){
+                bool hit = false;
+                if(src1_tag[i] == tag){ src1_tag[i] = -1; hit = true; }
+                if(src2_tag[i] == tag){ src2_tag[i] = -1; hit = true; }
+                if(hit && src1_tag[i] == -1 && src2_tag[i] == -1){
+                    ready[rob_tag[i] >> 6] |= 1ULL << (rob_tag[i] & 63);
                 }
             }
+#endif
         }
-        return avail_entries;
-    };
+    }
+
+    //collect up to n ready ROB tags into selected, oldest (nearest the ROB head) first
+    unsigned long oldest_ready(int head, unsigned long n){
+        if(selected.size() < n){
+            selected.resize(n);
+        }
+        int *tags = selected.data();
+        unsigned long found = 0;
+        unsigned long words = ready.size();
+        unsigned long w = head >> 6;
+        //bits at/after the head in its own word, then whole words, then the bits before the head
+        uint64_t bits = ready[w] & (~0ULL << (head & 63));
+        for(unsigned long visited = 0; visited <= words; visited++){
+            for(; bits != 0 && found < n; bits &= bits - 1){
+                tags[found++] = (w << 6) + __builtin_ctzll(bits);
+            }
+            if(found == n){
+                break;
+            }
+            w = (w + 1 == words) ? 0 : w + 1;
+            bits = ready[w];
+            if(visited + 1 == words){
+                bits &= ~(~0ULL << (head & 63));
+            }
+        }
+        return found;
+    }
 };
 
 
-//Issue Queue
-class Issue_Queue{
+//Per-Run State---------------------------------------------------------------------------------------------------------
+//everything one simulation touches lives here, so several runs can share a process
+//
+//in-flight instr. records live in a fixed slab and never move; pipeline latches, the IQ
+//and the ROB pass slab indices. at most rob_size instr. are renamed and WIDTH more sit
+//in each of DE and RN, so fetch order modulo the slab size never reuses a live record
+class Sim_State{
 public:
-    unsigned long iq_size;
-    std::vector<Instruction_Bundle> IQ;
+    proc_params params;
+    uint64_t num_cycles, num_instr, seq;     //seq: instr. retired
+    bool EOF_flag;
+    bool event_clock;           //skip cycles in which nothing but EX latencies can change
+    bool progress;              //some stage moved an instr. this cycle
+    Timing_Writer *timing_out;  //per-instruction timing output, NULL for none
+    Op_Table ops;               //latency and FUs per op_type
+    uint32_t stalls;            //stall_reason bits of this cycle
+    Sim_Stats *stats;           //stall/occupancy accounting, NULL for none
+    std::vector<Instruction_Bundle> slab;
+    unsigned long slab_next;
+    //**********************
+    //Pipeline Registers
+    Latch decode_bundle;
+    Latch rename_bundle;
+    Latch regRead_bundle;
+    Latch dispatch_bundle;
+    Latch writeback_bundle;
+    Latch execute_list;
+    //**********************
+    ROB ROB_table;
+    Issue_Queue issueQueue;
+    RMT RMT_table;
+
+    Sim_State(const proc_params &p) : params(p), num_cycles(0), num_instr(0), seq(0), EOF_flag(false), event_clock(true), progress(false),
+            timing_out(NULL), stalls(0), stats(NULL){
+        slab.resize(params.rob_size + 2 * params.width);
+        slab_next = 0;
+        decode_bundle.init(params.width);
+        rename_bundle.init(params.width);
+        regRead_bundle.init(params.width);
+        dispatch_bundle.init(params.width);
+        //everything in EX/WB holds a ROB entry
+        writeback_bundle.init(params.rob_size);
+        execute_list.init(params.rob_size);
+        //Re-Order Buffer (ROB)
+        ROB_table.head = ROB_table.tail = (params.rob_size > 3) ? 3 : 0; //rob3
+        ROB_table.count = 0;
+        ROB_table.rob_size = params.rob_size;
+        ROB_table.table.resize(params.rob_size);
+        //Issue_Queue issueQueue;
+        issueQueue.init(params.iq_size, params.rob_size);
+        //RMT
+        for(int i = 0; i < 67; i++){
+            RMT_table.reg_list[i].rob_tag = 0;
+            RMT_table.reg_list[i].valid = false;
+        }
+    }
+    bool pipeline_empty(){
+        return decode_bundle.empty() && rename_bundle.empty() && regRead_bundle.empty()
+                && dispatch_bundle.empty() && issueQueue.empty() && ROB_table.count == 0 && execute_list.empty()
+                && writeback_bundle.empty();
+    }
 };
 
 
-//Globals---------------------------------------------------------------------------------------------------------------
-int num_cycles, num_instr;
+//Core Configuration----------------------------------------------------------------------------------------------------
+//the stage functions that loop over WIDTH, wrap around the ROB, scan the IQ or pick latencies
+//take those bounds from a Cfg class:
+//  Runtime_Core          from proc_params and the Op_Table, any configuration
+//  Fixed_Core<R, Q, W>   compile-time ROB size, IQ size, width and the default op classes, so the
+//                        compiler can unroll the bundle/wakeup loops and strength-reduce the wrap-arounds
+//the Makefile lists the configurations specialized (SPECIALIZE), Select_Core() picks one per run
+//every function in this header is inline or a template, so any number of translation units
+//(and libsim users) can include it
+//storage stays in Sim_State, sized from the same parameters
+
+class Runtime_Core{
+public:
+    static unsigned long width(const Sim_State &sim){ return sim.params.width; }
+    static unsigned long rob_size(const Sim_State &sim){ return sim.params.rob_size; }
+    static unsigned long iq_slots(const Sim_State &sim){ return sim.issueQueue.num_slots; }
+    static int latency(const Sim_State &sim, int op){ return sim.ops.get_latency(op); }
+    static bool fu_limited(const Sim_State &sim){ return sim.ops.limited; }
+};
+
+template <unsigned long R, unsigned long Q, unsigned long W>
+class Fixed_Core{
+public:
+    static unsigned long width(const Sim_State &){ return W; }
+    static unsigned long rob_size(const Sim_State &){ return R; }
+    static unsigned long iq_slots(const Sim_State &){ return (Q + 3) & ~3UL; }
+    static int latency(const Sim_State &, int op){ return Op_Table::default_latency(op); }
+    static bool fu_limited(const Sim_State &){ return false; }
+};
+
+typedef bool (*step_fn)(Sim_State &sim, Trace_Reader &trace);
 
 
 //Pipeline Stage Functions----------------------------------------------------------------------------------------------
 
 //advance simulator cycle
 //if pipeline is empty AND no more trace instr. then exit loop
-bool Advance_Cycle(bool EOF_Flag, bool pipeline_empty){
-    num_cycles++;
+inline bool Advance_Cycle(Sim_State &sim, bool EOF_Flag, bool pipeline_empty){
+    sim.num_cycles++;
     return !(EOF_Flag && pipeline_empty);
     // continue simulation
 }
 
 //do nothing if no more trace instr. OR DE is not empty
 //otherwise, fetch up to WIDTH instr from trace into DE
-void Fetch(FILE *FP, unsigned long int width, std::vector<Instruction_Bundle> &decode_bundle, bool &EOF_flag){
-    int op_type, dest, src1, src2;  // Variables are read from trace file
-    unsigned int pc;           // Variable holds the pc read from input file
+//records come pre-decoded from the trace reader (text or binary trace)
+template <class Cfg>
+void Fetch(Sim_State &sim, Trace_Reader &trace){
+    const unsigned long width = Cfg::width(sim);
+    Latch &decode_bundle = sim.decode_bundle;
+    uint64_t &num_instr = sim.num_instr, num_cycles = sim.num_cycles;
     if(decode_bundle.empty()) {
         for(int i = 0; i<width; i++){
-            if (fscanf(FP, "%x %d %d %d %d", &pc, &op_type, &dest, &src1, &src2) != EOF) {
+            const trace_record *rec = trace.next();
+            if (rec != NULL) {
+                int op_type = rec->op_type;
                 num_instr += 1;
-                Instruction_Bundle add_instr;
-                add_instr.pc = pc;
+                instr_idx idx = sim.slab_next;
+                sim.slab_next = (sim.slab_next + 1 == sim.slab.size()) ? 0 : sim.slab_next + 1;
+                Instruction_Bundle &add_instr = sim.slab[idx];
+                add_instr.pc = rec->pc;
                 add_instr.rs1_rdy = add_instr.rs2_rdy = false;
                 add_instr.rs1_rob = add_instr.rs2_rob = false;
                 add_instr.op_type = op_type;
-                add_instr.dst = add_instr.dst_non_rob = dest;
-                add_instr.src1 = add_instr.src1_non_rob = src1;
-                add_instr.src2 = add_instr.src2_non_rob = src2;
-                add_instr.age_in_iss = 0;
-                if(op_type == 0){
-                    add_instr.latency = 1;
-                }
-                else if(op_type == 1){
-                    add_instr.latency = 2;
-                }
-                else{
-                    add_instr.latency = 5;
-                }
+                add_instr.dst = add_instr.dst_non_rob = rec->dst;
+                add_instr.src1 = add_instr.src1_non_rob = rec->src1;
+                add_instr.src2 = add_instr.src2_non_rob = rec->src2;
+                add_instr.latency = Cfg::latency(sim, op_type);
 
                 //timing information
                 add_instr.FE_begin = num_cycles;
@@ -150,14 +431,21 @@ void Fetch(FILE *FP, unsigned long int width, std::vector<Instruction_Bundle> &d
                 add_instr.DE_begin = num_cycles+1;
 
                 //Move to DE
-                decode_bundle.push_back(add_instr);
-                EOF_flag = false;
+                decode_bundle.push_back(idx);
+                sim.EOF_flag = false;
+                sim.progress = true;
             }
             else {
-                EOF_flag = true;
+                sim.EOF_flag = true;
+                if(i == 0){
+                    sim.stalls |= 1 << STALL_FE_EOF;
+                }
             }
         }
     }
+    else{
+        sim.stalls |= 1 << STALL_FE_DE_BUSY;
+    }
 }
 
 //if DE contains decode bundle:
@@ -165,17 +453,24 @@ void Fetch(FILE *FP, unsigned long int width, std::vector<Instruction_Bundle> &d
 //      * do nothing
 //  - if RN is empty
 //      * advance decode bundle to RN
-void Decode(std::vector<Instruction_Bundle> &rename_bundle, std::vector<Instruction_Bundle> &decode_bundle){
+inline void Decode(Sim_State &sim){
+    Latch &rename_bundle = sim.rename_bundle, &decode_bundle = sim.decode_bundle;
+    uint64_t num_cycles = sim.num_cycles;
     if(!decode_bundle.empty() && rename_bundle.empty()){
 
         for(int i = 0; i < decode_bundle.size(); i++){
+            Instruction_Bundle &instr = sim.slab[decode_bundle[i]];
             //timing information
-            decode_bundle.at(i).RN_begin = num_cycles+1;
-            decode_bundle.at(i).DE_cycles = decode_bundle.at(i).RN_begin - decode_bundle.at(i).DE_begin;
+            instr.RN_begin = num_cycles+1;
+            instr.DE_cycles = instr.RN_begin - instr.DE_begin;
         }
         //move to RN
         decode_bundle.swap(rename_bundle);
         decode_bundle.clear();
+        sim.progress = true;
+    }
+    else if(!decode_bundle.empty()){
+        sim.stalls |= 1 << STALL_DE_RN_BUSY;
     }
 };
 
@@ -184,56 +479,69 @@ void Decode(std::vector<Instruction_Bundle> &rename_bundle, std::vector<Instruct
 //      * do nothing
 //  - if RR is empty AND ROB is open to entries
 //      * process rename bundle and advance it to RR
-void Rename(RMT &RMT_table, ROB &ROB_table, std::vector<Instruction_Bundle> &rename_bundle,
-            std::vector<Instruction_Bundle> &regRead_bundle){
+template <class Cfg>
+void Rename(Sim_State &sim){
+    const unsigned long rob_size = Cfg::rob_size(sim);
+    RMT &RMT_table = sim.RMT_table;
+    ROB &ROB_table = sim.ROB_table;
+    Latch &rename_bundle = sim.rename_bundle, &regRead_bundle = sim.regRead_bundle;
+    uint64_t num_cycles = sim.num_cycles;
     if(!rename_bundle.empty() && regRead_bundle.empty()){
         //space unavailable in ROB
         if(ROB_table.space_available() < rename_bundle.size()){
+            sim.stalls |= 1 << STALL_RN_ROB_FULL;
             return;
         }
         //space available in ROB , process bundle
         else{
             for(int i = 0; i < rename_bundle.size(); i++){
+                Instruction_Bundle &instr = sim.slab[rename_bundle[i]];
                 //allocate space in ROB
-                ROB_table.table[ROB_table.tail].dest = rename_bundle.at(i).dst;
-                ROB_table.table[ROB_table.tail].pc = rename_bundle.at(i).pc;
+                ROB_table.table[ROB_table.tail].dest = instr.dst;
+                ROB_table.table[ROB_table.tail].pc = instr.pc;
                 ROB_table.table[ROB_table.tail].rdy = false;
+                ROB_table.table[ROB_table.tail].instr = rename_bundle[i];
+                ROB_table.count++;
                 //src1 reg rename
-                if(rename_bundle.at(i).src1 != -1){
-                    if(RMT_table.reg_list[rename_bundle.at(i).src1].valid){
-                        rename_bundle.at(i).src1 = RMT_table.reg_list[rename_bundle.at(i).src1].rob_tag;
-                        rename_bundle.at(i).rs1_rob = true;
+                if(instr.src1 != -1){
+                    if(RMT_table.reg_list[instr.src1].valid){
+                        instr.src1 = RMT_table.reg_list[instr.src1].rob_tag;
+                        instr.rs1_rob = true;
                     }
                 }
                 //src2 reg rename
-                if(rename_bundle.at(i).src2 != -1){
-                    if(RMT_table.reg_list[rename_bundle.at(i).src2].valid){
-                        rename_bundle.at(i).src2 = RMT_table.reg_list[rename_bundle.at(i).src2].rob_tag;
-                        rename_bundle.at(i).rs2_rob = true;
+                if(instr.src2 != -1){
+                    if(RMT_table.reg_list[instr.src2].valid){
+                        instr.src2 = RMT_table.reg_list[instr.src2].rob_tag;
+                        instr.rs2_rob = true;
                     }
                 }
                 //dst rename
-                if(rename_bundle.at(i).dst != -1){
-                    RMT_table.reg_list[rename_bundle.at(i).dst].valid = true;
-                    RMT_table.reg_list[rename_bundle.at(i).dst].rob_tag = ROB_table.tail;
+                if(instr.dst != -1){
+                    RMT_table.reg_list[instr.dst].valid = true;
+                    RMT_table.reg_list[instr.dst].rob_tag = ROB_table.tail;
                 }
-                rename_bundle.at(i).dst = ROB_table.tail;
+                instr.dst = ROB_table.tail;
                 //update ROB pointers
-                if(ROB_table.tail != (ROB_table.rob_size - 1)){
+                if(ROB_table.tail != (rob_size - 1)){
                     ROB_table.tail++;
                 }
                 else{
                     ROB_table.tail = 0;
                 }
                 //timing information
-                rename_bundle.at(i).RR_begin = num_cycles + 1;
-                rename_bundle.at(i).RN_cycles = rename_bundle.at(i).RR_begin - rename_bundle.at(i).RN_begin;
+                instr.RR_begin = num_cycles + 1;
+                instr.RN_cycles = instr.RR_begin - instr.RN_begin;
             }
             //move to RR
             rename_bundle.swap(regRead_bundle);
             rename_bundle.clear();
+            sim.progress = true;
         }
     }
+    else if(!rename_bundle.empty()){
+        sim.stalls |= 1 << STALL_RN_RR_BUSY;
+    }
 };
 
 //if RR contains RR bundle:
@@ -241,41 +549,48 @@ void Rename(RMT &RMT_table, ROB &ROB_table, std::vector<Instruction_Bundle> &ren
 //      * do nothing
 //  -if DI is empty
 //      * process RR bundle and advance to DI
-void RegRead(ROB &ROB_table, std::vector<Instruction_Bundle> &regRead_bundle,
-        std::vector<Instruction_Bundle> &dispatch_bundle){
+inline void RegRead(Sim_State &sim){
+    ROB &ROB_table = sim.ROB_table;
+    Latch &regRead_bundle = sim.regRead_bundle, &dispatch_bundle = sim.dispatch_bundle;
+    uint64_t num_cycles = sim.num_cycles;
     if(!regRead_bundle.empty() && dispatch_bundle.empty()){
         //model readiness of src regs
         for(int i = 0; i < regRead_bundle.size(); i++){
+            Instruction_Bundle &instr = sim.slab[regRead_bundle[i]];
             //src1
-            if(regRead_bundle.at(i).rs1_rob) {
-                if (ROB_table.table[regRead_bundle.at(i).src1].rdy) {
+            if(instr.rs1_rob) {
+                if (ROB_table.table[instr.src1].rdy) {
                     //dependency in ROB
-                    regRead_bundle.at(i).rs1_rdy = true;
+                    instr.rs1_rdy = true;
                 }
             }
             else{
                 //no dependencies
-                regRead_bundle.at(i).rs1_rdy = true;
+                instr.rs1_rdy = true;
             }
             //src2
-            if(regRead_bundle.at(i).rs2_rob) {
-                if (ROB_table.table[regRead_bundle.at(i).src2].rdy) {
+            if(instr.rs2_rob) {
+                if (ROB_table.table[instr.src2].rdy) {
                     //dependency in ROB
-                    regRead_bundle.at(i).rs2_rdy = true;
+                    instr.rs2_rdy = true;
                 }
             }
             else{
                 //no dependencies
-                regRead_bundle.at(i).rs2_rdy = true;
+                instr.rs2_rdy = true;
             }
 
             //update timing information
-            regRead_bundle.at(i).DI_begin = num_cycles + 1;
-            regRead_bundle.at(i).RR_cycles = regRead_bundle.at(i).DI_begin - regRead_bundle.at(i).RR_begin;
+            instr.DI_begin = num_cycles + 1;
+            instr.RR_cycles = instr.DI_begin - instr.RR_begin;
         }
         //move to DI
         regRead_bundle.swap(dispatch_bundle);
         regRead_bundle.clear();
+        sim.progress = true;
+    }
+    else if(!regRead_bundle.empty()){
+        sim.stalls |= 1 << STALL_RR_DI_BUSY;
     }
 };
 
@@ -284,42 +599,69 @@ void RegRead(ROB &ROB_table, std::vector<Instruction_Bundle> &regRead_bundle,
 //      * do nothing
 //  -if # free IQ entries is >= size of dispatch bundle in DI
 //      * dispatch all instr in DI to IQ
-void Dispatch(std::vector<Instruction_Bundle> &dispatch_bundle, Issue_Queue &issueQueue){
+inline void Dispatch(Sim_State &sim){
+    Latch &dispatch_bundle = sim.dispatch_bundle;
+    Issue_Queue &issueQueue = sim.issueQueue;
+    uint64_t num_cycles = sim.num_cycles;
     //check if IQ has available entries
-    if(!dispatch_bundle.empty() && ((issueQueue.iq_size - issueQueue.IQ.size()) >= dispatch_bundle.size())){
+    if(!dispatch_bundle.empty() && (issueQueue.space_available() >= dispatch_bundle.size())){
         for(int i = 0; i < dispatch_bundle.size(); i++){
+            Instruction_Bundle &instr = sim.slab[dispatch_bundle[i]];
             //timing information
-            dispatch_bundle.at(i).IS_begin = num_cycles + 1;
-            dispatch_bundle.at(i).DI_cycles = dispatch_bundle.at(i).IS_begin - dispatch_bundle.at(i).DI_begin;
+            instr.IS_begin = num_cycles + 1;
+            instr.DI_cycles = instr.IS_begin - instr.DI_begin;
             //move to IQ
-            issueQueue.IQ.push_back(dispatch_bundle.at(i));
+            issueQueue.insert(instr, dispatch_bundle[i]);
         }
         dispatch_bundle.clear();
+        sim.progress = true;
+    }
+    else if(!dispatch_bundle.empty()){
+        sim.stalls |= 1 << STALL_DI_IQ_FULL;
     }
 };
 
 //issue up to width oldest instructions from the IQ
-void Issue(unsigned long width, std::vector<Instruction_Bundle> &execute_list, Issue_Queue &issueQueue){
-    if(!issueQueue.IQ.empty()){
-        std::sort(issueQueue.IQ.begin(), issueQueue.IQ.end(), comparator());
-        int control = 1;
-        int issued = 0;
-        while(control != 0) {
-            control = 0;
-            for (int i = 0; i < issueQueue.IQ.size(); i++) {
-                if (issueQueue.IQ.at(i).rs1_rdy && issueQueue.IQ.at(i).rs2_rdy) {
-                    //timing information
-                    issueQueue.IQ.at(i).EX_begin = num_cycles + 1;
-                    issueQueue.IQ.at(i).IS_cycles = issueQueue.IQ.at(i).EX_begin - issueQueue.IQ.at(i).IS_begin;
-                    //move to EX
-                    execute_list.push_back(issueQueue.IQ.at(i));
-                    issueQueue.IQ.erase(issueQueue.IQ.begin() + i);
-                    issued++;
-                    control++;
-                    break;
+//with a limited number of FUs of a class, a ready instr. waits while its class's FUs are taken this cycle
+template <class Cfg>
+void Issue(Sim_State &sim){
+    const unsigned long width = Cfg::width(sim);
+    Latch &execute_list = sim.execute_list;
+    Issue_Queue &issueQueue = sim.issueQueue;
+    uint64_t num_cycles = sim.num_cycles;
+    if(!issueQueue.empty()){
+        unsigned long issued;
+        if(!Cfg::fu_limited(sim)){
+            issued = issueQueue.oldest_ready(sim.ROB_table.head, width);
+        }
+        else{
+            int busy[MAX_OP_TYPES] = {0};
+            unsigned long ready = issueQueue.oldest_ready(sim.ROB_table.head, issueQueue.iq_size);
+            issued = 0;
+            for(unsigned long i = 0; i < ready && issued < width; i++){
+                int tag = issueQueue.selected[i];
+                int fu = sim.ops.get_class(sim.slab[issueQueue.entry[issueQueue.slot_of[tag]]].op_type);
+                if(sim.ops.units[fu] == 0 || busy[fu] < sim.ops.units[fu]){
+                    busy[fu]++;
+                    issueQueue.selected[issued++] = tag;
                 }
             }
-            if (issued == width) { break; }
+            if(issued == 0 && ready != 0){
+                sim.stalls |= 1 << STALL_IS_FU_BUSY;
+            }
+        }
+        if(issued == 0 && !(sim.stalls & (1 << STALL_IS_FU_BUSY))){
+            sim.stalls |= 1 << STALL_IS_NOT_READY;
+        }
+        for(unsigned long i = 0; i < issued; i++){
+            instr_idx idx = issueQueue.remove(issueQueue.selected[i]);
+            Instruction_Bundle &instr = sim.slab[idx];
+            //timing information
+            instr.EX_begin = num_cycles + 1;
+            instr.IS_cycles = instr.EX_begin - instr.IS_begin;
+            //move to EX
+            execute_list.push_back(idx);
+            sim.progress = true;
         }
     }
 };
@@ -328,148 +670,250 @@ void Issue(unsigned long width, std::vector<Instruction_Bundle> &execute_list, I
 //  - remove instr from execute_list
 //  - add instr to WB
 //  - wakeup dependent instr. in the IQ/DI/RR stages (model readiness)
-void Execute(std::vector<Instruction_Bundle> &execute_list, std::vector<Instruction_Bundle> &writeback_bundle, Issue_Queue &issueQueue,
-             std::vector<Instruction_Bundle> &dispatch_bundle, std::vector<Instruction_Bundle> &regRead_bundle){
+template <class Cfg>
+void Execute(Sim_State &sim){
+    Latch &execute_list = sim.execute_list, &writeback_bundle = sim.writeback_bundle;
+    Latch &dispatch_bundle = sim.dispatch_bundle, &regRead_bundle = sim.regRead_bundle;
+    Issue_Queue &issueQueue = sim.issueQueue;
+    uint64_t num_cycles = sim.num_cycles;
     if(!execute_list.empty()) {
-        for (int j = 0; j < execute_list.size(); j++) {
-            execute_list.at(j).latency--;
-        }
-        int temp = 1;
-        while (temp != 0) {
-            temp = 0;
-            for (int i = 0; i < execute_list.size(); i++) {
-                if (execute_list.at(i).latency == 0) {
-                    //timing information
-                    execute_list.at(i).WB_begin = num_cycles + 1;
-                    execute_list.at(i).EX_cycles = execute_list.at(i).WB_begin - execute_list.at(i).EX_begin;
-                    //move to WB
-                    writeback_bundle.push_back(execute_list.at(i));
-
-                    //wakeup - IQ
-                    for (int j = 0; j < issueQueue.IQ.size(); j++) {
-                        if (issueQueue.IQ.at(j).src1 == execute_list.at(i).dst) {
-                            issueQueue.IQ.at(j).rs1_rdy = true;
-                        }
-                        if (issueQueue.IQ.at(j).src2 == execute_list.at(i).dst) {
-                            issueQueue.IQ.at(j).rs2_rdy = true;
-                        }
-                    }
-                    //wakeup - DI
-                    for (int k = 0; k < dispatch_bundle.size(); k++) {
-                        if (dispatch_bundle.at(k).src1 == execute_list.at(i).dst) {
-                            dispatch_bundle.at(k).rs1_rdy = true;
-                        }
-                        if (dispatch_bundle.at(k).src2 == execute_list.at(i).dst) {
-                            dispatch_bundle.at(k).rs2_rdy = true;
-                        }
-                    }
-                    //wakeup - RR
-                    for (int l = 0; l < regRead_bundle.size(); l++) {
-                        if (regRead_bundle.at(l).src1 == execute_list.at(i).dst) {
-                            regRead_bundle.at(l).rs1_rdy = true;
-                        }
-                        if (regRead_bundle.at(l).src2 == execute_list.at(i).dst) {
-                            regRead_bundle.at(l).rs2_rdy = true;
-                        }
-                    }
-                    //remove exec entry
-                    execute_list.erase(execute_list.begin() + i);
-                    temp++;
-                    break;
+        //finished instr. leave in list order, the rest are compacted in place
+        unsigned long kept = 0;
+        for (unsigned long i = 0; i < execute_list.size(); i++) {
+            Instruction_Bundle &instr = sim.slab[execute_list[i]];
+            if (--instr.latency != 0) {
+                execute_list[kept++] = execute_list[i];
+                continue;
+            }
+            //timing information
+            instr.WB_begin = num_cycles + 1;
+            instr.EX_cycles = instr.WB_begin - instr.EX_begin;
+            //move to WB
+            writeback_bundle.push_back(execute_list[i]);
+            sim.progress = true;
+
+            //wakeup - IQ
+            issueQueue.wakeup(instr.dst, Cfg::iq_slots(sim));
+            //wakeup - DI
+            for (int k = 0; k < dispatch_bundle.size(); k++) {
+                Instruction_Bundle &dep = sim.slab[dispatch_bundle[k]];
+                if (dep.src1 == instr.dst) {
+                    dep.rs1_rdy = true;
+                }
+                if (dep.src2 == instr.dst) {
+                    dep.rs2_rdy = true;
+                }
+            }
+            //wakeup - RR
+            for (int l = 0; l < regRead_bundle.size(); l++) {
+                Instruction_Bundle &dep = sim.slab[regRead_bundle[l]];
+                if (dep.src1 == instr.dst) {
+                    dep.rs1_rdy = true;
+                }
+                if (dep.src2 == instr.dst) {
+                    dep.rs2_rdy = true;
                 }
             }
         }
+        //remove exec entries
+        execute_list.resize(kept);
     }
 };
 
 //process WB bundle, mark instr 'ready' in ROB
-void Writeback(std::vector<Instruction_Bundle> &writeback_bundle, ROB &ROB_table, std::vector<Instruction_Bundle> &retire_bundle){
+inline void Writeback(Sim_State &sim){
+    Latch &writeback_bundle = sim.writeback_bundle;
+    ROB &ROB_table = sim.ROB_table;
+    uint64_t num_cycles = sim.num_cycles;
     if(!writeback_bundle.empty()){
         for(int i = 0; i < writeback_bundle.size(); i++){
+            Instruction_Bundle &instr = sim.slab[writeback_bundle[i]];
             //timing information
-            writeback_bundle.at(i).RT_begin = num_cycles + 1;
-            writeback_bundle.at(i).WB_cycles = writeback_bundle.at(i).RT_begin - writeback_bundle.at(i).WB_begin;
-            //rdy in ROB
-            ROB_table.table[writeback_bundle.at(i).dst].rdy = true;
-            //move to RT
-            retire_bundle.push_back(writeback_bundle.at(i));
+            instr.RT_begin = num_cycles + 1;
+            instr.WB_cycles = instr.RT_begin - instr.WB_begin;
+            //rdy in ROB, move to RT (the ROB entry already indexes the instr. record)
+            ROB_table.table[instr.dst].rdy = true;
         }
         writeback_bundle.clear();
+        sim.progress = true;
     }
 };
 
 //retire up to WIDTH consecutive 'ready' instr from ROB head
 //keep in mind RT->RR bypass
-void Retire(unsigned long width, ROB &ROB_table, std::vector<Instruction_Bundle> &retire_bundle,
-        std::vector<Instruction_Bundle> &regRead_bundle, RMT &RMT_table, int &seq){
+template <class Cfg>
+void Retire(Sim_State &sim){
+    const unsigned long width = Cfg::width(sim), rob_size = Cfg::rob_size(sim);
+    ROB &ROB_table = sim.ROB_table;
+    RMT &RMT_table = sim.RMT_table;
+    Latch &regRead_bundle = sim.regRead_bundle;
+    uint64_t &seq = sim.seq, num_cycles = sim.num_cycles;
     int num_retired = 0;
     while (num_retired < width) {
-        //pointers point to same entry (first or last RT in sim)
-        if ((ROB_table.tail == ROB_table.head) && (ROB_table.head != ROB_table.rob_size - 1)) {
-            if (ROB_table.table[ROB_table.head + 1].pc == 0) {
-                return;
-            }
+        //nothing left to retire
+        if (ROB_table.count == 0) {
+            return;
         }
         //rdy to RT
         if (ROB_table.table[ROB_table.head].rdy) {
             //RR bypass
             for (int i = 0; i < regRead_bundle.size(); i++) {
-                if (ROB_table.head == regRead_bundle.at(i).src1) {
-                    regRead_bundle.at(i).rs1_rdy = true;
+                Instruction_Bundle &dep = sim.slab[regRead_bundle[i]];
+                if (ROB_table.head == dep.src1) {
+                    dep.rs1_rdy = true;
                 }
-                if (ROB_table.head == regRead_bundle.at(i).src2) {
-                    regRead_bundle.at(i).rs2_rdy = true;
+                if (ROB_table.head == dep.src2) {
+                    dep.rs2_rdy = true;
                 }
             }
-            //clr entry in RMT
-            for (int j = 0; j < 67; j++) {
-                if (ROB_table.head == RMT_table.reg_list[j].rob_tag && RMT_table.reg_list[j].valid) {
-                    RMT_table.reg_list[j].valid = false;
-                    RMT_table.reg_list[j].rob_tag = 0;
-                }
+            //clr entry in RMT - only the register this entry renamed can still map to it
+            ROB_ENTRY &entry = ROB_table.table[ROB_table.head];
+            if (entry.dest != -1 && RMT_table.reg_list[entry.dest].valid
+                    && RMT_table.reg_list[entry.dest].rob_tag == ROB_table.head) {
+                RMT_table.reg_list[entry.dest].valid = false;
+                RMT_table.reg_list[entry.dest].rob_tag = 0;
             }
             //retire entry in ROB - preserve program order
-            for (int k = 0; k < retire_bundle.size(); k++) {
-                if (ROB_table.table[ROB_table.head].pc == retire_bundle.at(k).pc) {
-                    //timing information
-                    retire_bundle.at(k).RT_cycles = (num_cycles + 1) - retire_bundle.at(k).RT_begin;
-
-                    //print encoded timing information
-                    //<seq_no> fu{<op_type>} src{<src1>,<src2>} dst{<dst>}
-                    //FE{<begin-cycle>,<duration>} DE{…} RN{…} RR{…} DI{…} IS{…} EX{…}
-                    //WB{…} RT{…}
-                    printf("%d fu{%d} ", seq, retire_bundle.at(k).op_type);
-                    printf("src{%d,%d} ", retire_bundle.at(k).src1_non_rob, retire_bundle.at(k).src2_non_rob);
-                    printf("dst{%d} ", retire_bundle.at(k).dst_non_rob);
-                    printf("FE{%d,%d} ", retire_bundle.at(k).FE_begin, retire_bundle.at(k).FE_cycles);
-                    printf("DE{%d,%d} ", retire_bundle.at(k).DE_begin, retire_bundle.at(k).DE_cycles);
-                    printf("RN{%d,%d} ", retire_bundle.at(k).RN_begin, retire_bundle.at(k).RN_cycles);
-                    printf("RR{%d,%d} ", retire_bundle.at(k).RR_begin, retire_bundle.at(k).RR_cycles);
-                    printf("DI{%d,%d} ", retire_bundle.at(k).DI_begin, retire_bundle.at(k).DI_cycles);
-                    printf("IS{%d,%d} ", retire_bundle.at(k).IS_begin, retire_bundle.at(k).IS_cycles);
-                    printf("EX{%d,%d} ", retire_bundle.at(k).EX_begin, retire_bundle.at(k).EX_cycles);
-                    printf("WB{%d,%d} ", retire_bundle.at(k).WB_begin, retire_bundle.at(k).WB_cycles);
-                    printf("RT{%d,%d}\n", retire_bundle.at(k).RT_begin, retire_bundle.at(k).RT_cycles);
-                    seq++;
-                    //clr RT instr
-                    retire_bundle.erase(retire_bundle.begin() + k);
-                    break;
-                }
+            Instruction_Bundle &instr = sim.slab[entry.instr];
+            //timing information
+            instr.RT_cycles = (num_cycles + 1) - instr.RT_begin;
+
+            //print encoded timing information
+            //<seq_no> fu{<op_type>} src{<src1>,<src2>} dst{<dst>}
+            //FE{<begin-cycle>,<duration>} DE{…} RN{…} RR{…} DI{…} IS{…} EX{…}
+            //WB{…} RT{…}
+            if(sim.timing_out != NULL){
+                timing_record rec;
+                rec.seq = seq;
+                rec.op_type = instr.op_type;
+                rec.src1 = instr.src1_non_rob;
+                rec.src2 = instr.src2_non_rob;
+                rec.dst = instr.dst_non_rob;
+                rec.begin[STAGE_FE] = instr.FE_begin;  rec.cycles[STAGE_FE] = instr.FE_cycles;
+                rec.begin[STAGE_DE] = instr.DE_begin;  rec.cycles[STAGE_DE] = instr.DE_cycles;
+                rec.begin[STAGE_RN] = instr.RN_begin;  rec.cycles[STAGE_RN] = instr.RN_cycles;
+                rec.begin[STAGE_RR] = instr.RR_begin;  rec.cycles[STAGE_RR] = instr.RR_cycles;
+                rec.begin[STAGE_DI] = instr.DI_begin;  rec.cycles[STAGE_DI] = instr.DI_cycles;
+                rec.begin[STAGE_IS] = instr.IS_begin;  rec.cycles[STAGE_IS] = instr.IS_cycles;
+                rec.begin[STAGE_EX] = instr.EX_begin;  rec.cycles[STAGE_EX] = instr.EX_cycles;
+                rec.begin[STAGE_WB] = instr.WB_begin;  rec.cycles[STAGE_WB] = instr.WB_cycles;
+                rec.begin[STAGE_RT] = instr.RT_begin;  rec.cycles[STAGE_RT] = instr.RT_cycles;
+                sim.timing_out->put(rec);
             }
+            seq++;
             //retire entry in ROB - preserve program order cont.
-            ROB_table.table[ROB_table.head].clr();
+            entry.clr();
+            ROB_table.count--;
             //update ROB pointers
-            if (ROB_table.head != (ROB_table.rob_size - 1)) {
+            if (ROB_table.head != (rob_size - 1)) {
                 ROB_table.head++;
             } else {
                 ROB_table.head = 0;
             }
             //control
             num_retired++;
+            sim.progress = true;
         }
         else{
+            if(num_retired == 0){
+                sim.stalls |= 1 << STALL_RT_NOT_READY;
+            }
             return;
         }
     }
 };
+
+
+//Simulation Driver-----------------------------------------------------------------------------------------------------
+
+//no stage moved an instr. this cycle, so the state is the same next cycle except for the
+//latencies counting down in EX, and nothing can move until the first of those reaches 0:
+//jump to the cycle it finishes in, as if Execute had counted every latency down one at a time
+//returns the number of cycles skipped
+inline int Skip_Idle_Cycles(Sim_State &sim){
+    Latch &execute_list = sim.execute_list;
+    int skip = 0;
+    for(unsigned long i = 0; i < execute_list.size(); i++){
+        int latency = sim.slab[execute_list[i]].latency;
+        if(i == 0 || latency - 1 < skip){
+            skip = latency - 1;
+        }
+    }
+    if(skip <= 0){
+        return 0;
+    }
+    for(unsigned long i = 0; i < execute_list.size(); i++){
+        sim.slab[execute_list[i]].latency -= skip;
+    }
+    sim.num_cycles += skip;
+    return skip;
+}
+
+//add this cycle, and the idle cycles skipped after it, to the stall counters and occupancy histograms
+inline void Account_Cycle(Sim_State &sim, int skipped){
+    sim.stats->account(sim.stalls, sim.ROB_table.rob_size - sim.ROB_table.space_available(), sim.issueQueue.count,
+            sim.execute_list.size(), 1 + skipped);
+}
+
+//simulate one cycle (and, with the event clock, any idle cycles after it),
+//returns false once the trace is exhausted and the pipeline has drained
+template <class Cfg>
+bool Step(Sim_State &sim, Trace_Reader &trace){
+    //true denotes current stage is empty or ready to accept new bundle
+    //false denotes current stage has a bundle or can't accept new bundle
+    sim.progress = false;
+    sim.stalls = 0;
+    Retire<Cfg>(sim);
+    Writeback(sim);
+    Execute<Cfg>(sim);
+    Issue<Cfg>(sim);
+    Dispatch(sim);
+    RegRead(sim);
+    Rename<Cfg>(sim);
+    Decode(sim);
+    Fetch<Cfg>(sim, trace);
+    bool pipeline_empty = sim.pipeline_empty();
+    if(!Advance_Cycle(sim, sim.EOF_flag, pipeline_empty)){
+        if(sim.stats != NULL){
+            Account_Cycle(sim, 0);
+        }
+        return false;
+    }
+    int skipped = 0;
+    if(sim.event_clock && !sim.progress){
+        skipped = Skip_Idle_Cycles(sim);
+    }
+    if(sim.stats != NULL){
+        Account_Cycle(sim, skipped);
+    }
+    return true;
+}
+
+//the core for sim's configuration: a specialization if one was built for it, else the generic one
+//(defined in sim_core.cc, the one translation unit compiled with the SPECIALIZE list)
+step_fn Select_Core(const Sim_State &sim);
+
+//the configurations Select_Core() has a specialization for (the Makefile's SPECIALIZE list)
+std::vector<proc_params> Fixed_Core_Configs();
+
+//run one configuration until the trace is exhausted and the pipeline drains
+inline void Simulate(Sim_State &sim, Trace_Reader &trace){
+    step_fn step = Select_Core(sim);
+    while (step(sim, trace)){
+    }
+}
+
+//end of run report
+inline void Print_Summary(FILE *out, const proc_params &params, uint64_t num_instr, uint64_t num_cycles, const char *trace_file){
+    fprintf(out, "# === Simulator Command =========\n");
+    fprintf(out, "# ./sim %lu %lu %lu %s\n", params.rob_size, params.iq_size, params.width, trace_file);
+    fprintf(out, "# === Processor Configuration ===\n");
+    fprintf(out, "# ROB_SIZE = %lu\n", params.rob_size);
+    fprintf(out, "# IQ_SIZE  = %lu\n", params.iq_size);
+    fprintf(out, "# WIDTH    = %lu\n", params.width);
+    fprintf(out, "# === Simulation Results ========\n");
+    fprintf(out, "# Dynamic Instruction Count    = %llu\n", (unsigned long long)num_instr);
+    fprintf(out, "# Cycles                       = %llu\n", (unsigned long long)num_cycles);
+    fprintf(out, "# Instructions Per Cycle (IPC) = %2.2f\n", float(num_instr)/float(num_cycles));
+}
 #endif
\ No newline at end of file
@@ -0,0 +1,453 @@
+#ifndef SIM_REF_H
+#define SIM_REF_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+
+#include "sim_proc.h"
+
+//Reference Engine------------------------------------------------------------------------------------------------------
+//
+//the pipeline as it was first written: instr. records copied by value from latch to latch,
+//the IQ a vector in dispatch order scanned for ready entries, wakeup a linear search of the IQ,
+//the RMT cleared by scanning all of it, one cycle per step. nothing is specialized, indexed or
+//skipped, so it's slow and easy to read, and stays the definition of cycle-exact behavior that
+//the stage functions in sim_proc.h are checked against (sim_check.cc)
+//
+//it has the same stage order, same oldest-first issue, same op classes and FU limits as the
+//optimized engine, and shares Instruction_Bundle, ROB_ENTRY and RMT with it; it never runs in sim
+
+class Ref_State{
+public:
+    proc_params params;
+    Op_Table ops;
+    uint64_t num_cycles, num_instr, seq;
+    bool EOF_flag;
+    std::vector<Instruction_Bundle> decode_bundle, rename_bundle, regRead_bundle, dispatch_bundle;
+    std::vector<Instruction_Bundle> IQ;                 //dispatch order
+    std::vector<Instruction_Bundle> execute_list, writeback_bundle;
+    std::vector<Instruction_Bundle> retire_list;        //written back, waiting in the ROB
+    std::vector<ROB_ENTRY> rob;
+    int head, tail;
+    unsigned long rob_count;
+    RMT RMT_table;
+
+    Ref_State(const proc_params &p, const Op_Table &o) : params(p), ops(o), num_cycles(0), num_instr(0), seq(0), EOF_flag(false),
+            rob(p.rob_size), head((p.rob_size > 3) ? 3 : 0), tail(head), rob_count(0){
+        for(int i = 0; i < 67; i++){
+            RMT_table.reg_list[i].valid = false;
+            RMT_table.reg_list[i].rob_tag = 0;
+        }
+    }
+    bool pipeline_empty() const {
+        return decode_bundle.empty() && rename_bundle.empty() && regRead_bundle.empty() && dispatch_bundle.empty()
+                && IQ.empty() && execute_list.empty() && writeback_bundle.empty() && rob_count == 0;
+    }
+};
+
+//set rs1_rdy/rs2_rdy of every instr. in list waiting on ROB tag
+inline void Ref_Wakeup(std::vector<Instruction_Bundle> &list, int tag){
+    for(size_t i = 0; i < list.size(); i++){
+        if(list[i].src1 == tag){
+            list[i].rs1_rdy = true;
+        }
+        if(list[i].src2 == tag){
+            list[i].rs2_rdy = true;
+        }
+    }
+}
+
+inline void Ref_Retire(Ref_State &s){
+    for(unsigned long n = 0; n < s.params.width && s.rob_count != 0 && s.rob[s.head].rdy; n++){
+        //RR bypass
+        Ref_Wakeup(s.regRead_bundle, s.head);
+        for(int j = 0; j < 67; j++){
+            if(s.RMT_table.reg_list[j].valid && s.RMT_table.reg_list[j].rob_tag == s.head){
+                s.RMT_table.reg_list[j].valid = false;
+                s.RMT_table.reg_list[j].rob_tag = 0;
+            }
+        }
+        for(size_t k = 0; k < s.retire_list.size(); k++){
+            if(s.retire_list[k].dst == s.head){
+                s.retire_list.erase(s.retire_list.begin() + k);
+                break;
+            }
+        }
+        s.rob[s.head].clr();
+        s.rob_count--;
+        s.head = (s.head + 1) % s.params.rob_size;
+        s.seq++;
+    }
+}
+
+inline void Ref_Writeback(Ref_State &s){
+    for(size_t i = 0; i < s.writeback_bundle.size(); i++){
+        Instruction_Bundle &instr = s.writeback_bundle[i];
+        instr.RT_begin = s.num_cycles + 1;
+        instr.WB_cycles = instr.RT_begin - instr.WB_begin;
+        s.rob[instr.dst].rdy = true;
+        s.retire_list.push_back(instr);
+    }
+    s.writeback_bundle.clear();
+}
+
+inline void Ref_Execute(Ref_State &s){
+    for(size_t i = 0; i < s.execute_list.size(); i++){
+        s.execute_list[i].latency--;
+    }
+    for(size_t i = 0; i < s.execute_list.size(); ){
+        Instruction_Bundle instr = s.execute_list[i];
+        if(instr.latency != 0){
+            i++;
+            continue;
+        }
+        instr.WB_begin = s.num_cycles + 1;
+        instr.EX_cycles = instr.WB_begin - instr.EX_begin;
+        s.writeback_bundle.push_back(instr);
+        Ref_Wakeup(s.IQ, instr.dst);
+        Ref_Wakeup(s.dispatch_bundle, instr.dst);
+        Ref_Wakeup(s.regRead_bundle, instr.dst);
+        s.execute_list.erase(s.execute_list.begin() + i);
+    }
+}
+
+inline void Ref_Issue(Ref_State &s){
+    int busy[MAX_OP_TYPES] = {0};
+    unsigned long issued = 0;
+    for(size_t i = 0; i < s.IQ.size() && issued < s.params.width; ){
+        Instruction_Bundle &instr = s.IQ[i];
+        int fu = s.ops.get_class(instr.op_type);
+        if(!instr.rs1_rdy || !instr.rs2_rdy || (s.ops.units[fu] != 0 && busy[fu] == s.ops.units[fu])){
+            i++;
+            continue;
+        }
+        busy[fu]++;
+        instr.EX_begin = s.num_cycles + 1;
+        instr.IS_cycles = instr.EX_begin - instr.IS_begin;
+        s.execute_list.push_back(instr);
+        s.IQ.erase(s.IQ.begin() + i);
+        issued++;
+    }
+}
+
+inline void Ref_Dispatch(Ref_State &s){
+    if(s.dispatch_bundle.empty() || s.params.iq_size - s.IQ.size() < s.dispatch_bundle.size()){
+        return;
+    }
+    for(size_t i = 0; i < s.dispatch_bundle.size(); i++){
+        Instruction_Bundle &instr = s.dispatch_bundle[i];
+        instr.IS_begin = s.num_cycles + 1;
+        instr.DI_cycles = instr.IS_begin - instr.DI_begin;
+        s.IQ.push_back(instr);
+    }
+    s.dispatch_bundle.clear();
+}
+
+inline void Ref_RegRead(Ref_State &s){
+    if(s.regRead_bundle.empty() || !s.dispatch_bundle.empty()){
+        return;
+    }
+    for(size_t i = 0; i < s.regRead_bundle.size(); i++){
+        Instruction_Bundle &instr = s.regRead_bundle[i];
+        if(!instr.rs1_rob || s.rob[instr.src1].rdy){
+            instr.rs1_rdy = true;
+        }
+        if(!instr.rs2_rob || s.rob[instr.src2].rdy){
+            instr.rs2_rdy = true;
+        }
+        instr.DI_begin = s.num_cycles + 1;
+        instr.RR_cycles = instr.DI_begin - instr.RR_begin;
+    }
+    s.regRead_bundle.swap(s.dispatch_bundle);
+    s.regRead_bundle.clear();
+}
+
+inline void Ref_Rename(Ref_State &s){
+    if(s.rename_bundle.empty() || !s.regRead_bundle.empty() || s.params.rob_size - s.rob_count < s.rename_bundle.size()){
+        return;
+    }
+    for(size_t i = 0; i < s.rename_bundle.size(); i++){
+        Instruction_Bundle &instr = s.rename_bundle[i];
+        s.rob[s.tail].dest = instr.dst;
+        s.rob[s.tail].pc = instr.pc;
+        s.rob[s.tail].rdy = false;
+        s.rob_count++;
+        if(instr.src1 != -1 && s.RMT_table.reg_list[instr.src1].valid){
+            instr.src1 = s.RMT_table.reg_list[instr.src1].rob_tag;
+            instr.rs1_rob = true;
+        }
+        if(instr.src2 != -1 && s.RMT_table.reg_list[instr.src2].valid){
+            instr.src2 = s.RMT_table.reg_list[instr.src2].rob_tag;
+            instr.rs2_rob = true;
+        }
+        if(instr.dst != -1){
+            s.RMT_table.reg_list[instr.dst].valid = true;
+            s.RMT_table.reg_list[instr.dst].rob_tag = s.tail;
+        }
+        instr.dst = s.tail;
+        s.tail = (s.tail + 1) % s.params.rob_size;
+        instr.RR_begin = s.num_cycles + 1;
+        instr.RN_cycles = instr.RR_begin - instr.RN_begin;
+    }
+    s.rename_bundle.swap(s.regRead_bundle);
+    s.rename_bundle.clear();
+}
+
+inline void Ref_Decode(Ref_State &s){
+    if(s.decode_bundle.empty() || !s.rename_bundle.empty()){
+        return;
+    }
+    for(size_t i = 0; i < s.decode_bundle.size(); i++){
+        s.decode_bundle[i].RN_begin = s.num_cycles + 1;
+        s.decode_bundle[i].DE_cycles = s.decode_bundle[i].RN_begin - s.decode_bundle[i].DE_begin;
+    }
+    s.decode_bundle.swap(s.rename_bundle);
+    s.decode_bundle.clear();
+}
+
+inline void Ref_Fetch(Ref_State &s, Trace_Reader &trace){
+    if(!s.decode_bundle.empty()){
+        return;
+    }
+    for(unsigned long i = 0; i < s.params.width; i++){
+        const trace_record *rec = trace.next();
+        if(rec == NULL){
+            s.EOF_flag = true;
+            continue;
+        }
+        Instruction_Bundle instr = Instruction_Bundle();
+        instr.pc = rec->pc;
+        instr.op_type = rec->op_type;
+        instr.dst = instr.dst_non_rob = rec->dst;
+        instr.src1 = instr.src1_non_rob = rec->src1;
+        instr.src2 = instr.src2_non_rob = rec->src2;
+        instr.latency = s.ops.get_latency(rec->op_type);
+        instr.FE_begin = s.num_cycles;
+        instr.FE_cycles = 1;
+        instr.DE_begin = s.num_cycles + 1;
+        s.decode_bundle.push_back(instr);
+        s.num_instr++;
+        s.EOF_flag = false;
+    }
+}
+
+//simulate one cycle, returns false once the trace is exhausted and the pipeline has drained
+inline bool Ref_Step(Ref_State &s, Trace_Reader &trace){
+    Ref_Retire(s);
+    Ref_Writeback(s);
+    Ref_Execute(s);
+    Ref_Issue(s);
+    Ref_Dispatch(s);
+    Ref_RegRead(s);
+    Ref_Rename(s);
+    Ref_Decode(s);
+    Ref_Fetch(s, trace);
+    s.num_cycles++;
+    return !(s.EOF_flag && s.pipeline_empty());
+}
+
+
+//State Digests---------------------------------------------------------------------------------------------------------
+//
+//a canonical walk of the architectural pipeline state, the same for both engines whatever
+//their data structures: counters, the ROB from head to tail, the RMT, then every latch and the
+//IQ, EX and WB contents, each instr. with its renamed operands, readiness and the begin cycles
+//of the stages it has entered. the IQ, EX and WB are unordered sets, walked in program order
+//(ROB tag from the head). the words are folded into a 64-bit hash; on a mismatch the same walk
+//is rerun with the field names kept, to dump and diff
+
+class State_Digest{
+public:
+    uint64_t hash;
+    bool verbose;
+    std::string section, item;
+    std::vector<std::string> lines;     //"section item.field = value", verbose only
+
+    State_Digest(bool v = false) : hash(0x9E3779B97F4A7C15ULL), verbose(v){}
+    void begin(const char *name){
+        if(verbose){
+            section = name;
+            item.clear();
+        }
+        add("", 0x5EC7105EC7105EC7LL);
+    }
+    //name the instr. the next fields belong to
+    void label(const char *name, unsigned long long n){
+        if(verbose){
+            char buf[32];
+            snprintf(buf, sizeof(buf), "%s%llu.", name, n);
+            item = buf;
+        }
+    }
+    void add(const char *field, int64_t value){
+        hash = (hash ^ (uint64_t)value) * 0x100000001B3ULL;
+        hash ^= hash >> 29;
+        if(verbose && *field != '\0'){
+            char buf[160];
+            snprintf(buf, sizeof(buf), "%s %s%s = %lld", section.c_str(), item.c_str(), field, (long long)value);
+            lines.push_back(buf);
+        }
+    }
+};
+
+inline uint64_t stage_begin(const Instruction_Bundle &instr, int stage){
+    switch(stage){
+        case STAGE_FE: return instr.FE_begin;
+        case STAGE_DE: return instr.DE_begin;
+        case STAGE_RN: return instr.RN_begin;
+        case STAGE_RR: return instr.RR_begin;
+        case STAGE_DI: return instr.DI_begin;
+        case STAGE_IS: return instr.IS_begin;
+        case STAGE_EX: return instr.EX_begin;
+        case STAGE_WB: return instr.WB_begin;
+        default:       return instr.RT_begin;
+    }
+}
+
+//the i-th instr. of a section, which has entered stage; readiness only where it's live (DI and IS)
+inline void digest_instr(State_Digest &d, size_t i, const Instruction_Bundle &instr, int stage, int rdy){
+    d.label("#", i);
+    d.add("pc", instr.pc);
+    d.add("op", instr.op_type);
+    d.add("dst", instr.dst);
+    d.add("src1", instr.src1);
+    d.add("src2", instr.src2);
+    d.add("rs_rob", instr.rs1_rob + 2 * instr.rs2_rob);
+    if(stage == STAGE_DI || stage == STAGE_IS){
+        d.add("rs_rdy", rdy);
+    }
+    if(stage == STAGE_EX){
+        d.add("latency", instr.latency);
+    }
+    for(int k = STAGE_FE; k <= stage; k++){
+        d.add(STAGE_NAMES[k], stage_begin(instr, k));
+    }
+}
+
+//instr. in program order: position of ROB tag from head
+inline unsigned long rob_age(int tag, int head, unsigned long rob_size){
+    return (tag - head + rob_size) % rob_size;
+}
+
+//an unordered set of renamed instr., walked in program order; ready(instr) gives rs1_rdy + 2*rs2_rdy
+template <class Ready>
+void digest_set(State_Digest &d, const char *name, std::vector<const Instruction_Bundle *> instrs, int stage, int head,
+        unsigned long rob_size, Ready ready){
+    d.begin(name);
+    d.add("count", instrs.size());
+    std::sort(instrs.begin(), instrs.end(), [&](const Instruction_Bundle *a, const Instruction_Bundle *b){
+        return rob_age(a->dst, head, rob_size) < rob_age(b->dst, head, rob_size);
+    });
+    for(size_t i = 0; i < instrs.size(); i++){
+        digest_instr(d, i, *instrs[i], stage, ready(*instrs[i]));
+    }
+}
+
+inline int no_ready(const Instruction_Bundle &){
+    return 0;
+}
+
+//a latch, in its own order (program order)
+inline void digest_latch(State_Digest &d, const char *name, const std::vector<const Instruction_Bundle *> &instrs, int stage){
+    d.begin(name);
+    d.add("count", instrs.size());
+    for(size_t i = 0; i < instrs.size(); i++){
+        digest_instr(d, i, *instrs[i], stage, instrs[i]->rs1_rdy + 2 * instrs[i]->rs2_rdy);
+    }
+}
+
+//the parts both engines lay out the same way
+inline void digest_common(State_Digest &d, uint64_t num_cycles, uint64_t num_instr, uint64_t seq, bool eof,
+        const std::vector<ROB_ENTRY> &rob, int head, int tail, unsigned long count, const RMT &rmt){
+    d.begin("cycle");
+    d.add("num_cycles", num_cycles);
+    d.add("num_instr", num_instr);
+    d.add("retired", seq);
+    d.add("eof", eof);
+    d.begin("ROB");
+    d.add("head", head);
+    d.add("tail", tail);
+    d.add("count", count);
+    for(unsigned long i = 0, t = head; i < count; i++, t = (t + 1 == rob.size()) ? 0 : t + 1){
+        d.label("", t);
+        d.add("pc", rob[t].pc);
+        d.add("dest", rob[t].dest);
+        d.add("rdy", rob[t].rdy);
+    }
+    d.begin("RMT");
+    for(int r = 0; r < 67; r++){
+        d.label("r", r);
+        d.add("valid", rmt.reg_list[r].valid);
+        d.add("rob_tag", rmt.reg_list[r].valid ? rmt.reg_list[r].rob_tag : 0);
+    }
+}
+
+inline std::vector<const Instruction_Bundle *> latch_instrs(const Sim_State &sim, const Latch &latch){
+    std::vector<const Instruction_Bundle *> v;
+    for(unsigned long i = 0; i < latch.count; i++){
+        v.push_back(&sim.slab[latch.idx[i]]);
+    }
+    return v;
+}
+
+inline std::vector<const Instruction_Bundle *> list_instrs(const std::vector<Instruction_Bundle> &list){
+    std::vector<const Instruction_Bundle *> v;
+    for(size_t i = 0; i < list.size(); i++){
+        v.push_back(&list[i]);
+    }
+    return v;
+}
+
+inline void Digest_State(const Sim_State &sim, State_Digest &d){
+    const ROB &rob = sim.ROB_table;
+    const Issue_Queue &iq = sim.issueQueue;
+    digest_common(d, sim.num_cycles, sim.num_instr, sim.seq, sim.EOF_flag, rob.table, rob.head, rob.tail, rob.count, sim.RMT_table);
+    digest_latch(d, "DE", latch_instrs(sim, sim.decode_bundle), STAGE_DE);
+    digest_latch(d, "RN", latch_instrs(sim, sim.rename_bundle), STAGE_RN);
+    digest_latch(d, "RR", latch_instrs(sim, sim.regRead_bundle), STAGE_RR);
+    digest_latch(d, "DI", latch_instrs(sim, sim.dispatch_bundle), STAGE_DI);
+    //occupied IQ slots are the ones not on the free list; readiness lives in their source tags
+    std::vector<bool> occupied(iq.iq_size, true);
+    for(size_t i = 0; i < iq.free_slots.size(); i++){
+        occupied[iq.free_slots[i]] = false;
+    }
+    std::vector<const Instruction_Bundle *> waiting;
+    std::vector<int> rdy(rob.rob_size, 0);
+    for(unsigned long slot = 0; slot < iq.iq_size; slot++){
+        if(occupied[slot]){
+            waiting.push_back(&sim.slab[iq.entry[slot]]);
+            rdy[iq.rob_tag[slot]] = (iq.src1_tag[slot] == -1) + 2 * (iq.src2_tag[slot] == -1);
+        }
+    }
+    digest_set(d, "IQ", waiting, STAGE_IS, rob.head, rob.rob_size, [&](const Instruction_Bundle &instr){
+        return rdy[instr.dst];
+    });
+    digest_set(d, "EX", latch_instrs(sim, sim.execute_list), STAGE_EX, rob.head, rob.rob_size, no_ready);
+    digest_set(d, "WB", latch_instrs(sim, sim.writeback_bundle), STAGE_WB, rob.head, rob.rob_size, no_ready);
+    std::vector<const Instruction_Bundle *> done;
+    for(unsigned long i = 0, t = rob.head; i < rob.count; i++, t = (t + 1 == rob.rob_size) ? 0 : t + 1){
+        if(rob.table[t].rdy){
+            done.push_back(&sim.slab[rob.table[t].instr]);
+        }
+    }
+    digest_set(d, "RT", done, STAGE_RT, rob.head, rob.rob_size, no_ready);
+}
+
+inline void Digest_State(const Ref_State &s, State_Digest &d){
+    digest_common(d, s.num_cycles, s.num_instr, s.seq, s.EOF_flag, s.rob, s.head, s.tail, s.rob_count, s.RMT_table);
+    digest_latch(d, "DE", list_instrs(s.decode_bundle), STAGE_DE);
+    digest_latch(d, "RN", list_instrs(s.rename_bundle), STAGE_RN);
+    digest_latch(d, "RR", list_instrs(s.regRead_bundle), STAGE_RR);
+    digest_latch(d, "DI", list_instrs(s.dispatch_bundle), STAGE_DI);
+    digest_set(d, "IQ", list_instrs(s.IQ), STAGE_IS, s.head, s.params.rob_size, [](const Instruction_Bundle &instr){
+        return instr.rs1_rdy + 2 * instr.rs2_rdy;
+    });
+    digest_set(d, "EX", list_instrs(s.execute_list), STAGE_EX, s.head, s.params.rob_size, no_ready);
+    digest_set(d, "WB", list_instrs(s.writeback_bundle), STAGE_WB, s.head, s.params.rob_size, no_ready);
+    digest_set(d, "RT", list_instrs(s.retire_list), STAGE_RT, s.head, s.params.rob_size, no_ready);
+}
+
+#endif
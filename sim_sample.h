@@ -0,0 +1,126 @@
+#ifndef SIM_SAMPLE_H
+#define SIM_SAMPLE_H
+
+#include <cmath>
+#include <cstdlib>
+
+#include "sim_proc.h"
+
+//Sampled Simulation----------------------------------------------------------------------------------------------------
+//
+//./sim --sample=PERIOD[:UNIT[:WARMUP]] <rob_size> <iq_size> <width> <trace_file>
+//
+//systematic (SMARTS-style) sampling: every PERIOD instr. the trace is
+//  fast-forwarded   PERIOD-WARMUP-UNIT instr., skipped without entering the pipeline
+//  warmed up        WARMUP instr. simulated in detail from a drained machine, not measured
+//  measured         UNIT instr. simulated in detail, their cycles per instr. is one sample
+//UNIT defaults to 1000 and WARMUP to 2000; WARMUP should cover a few ROBs' worth of instr.
+//
+//the pipeline has no state that outlives an instr.'s flight (no caches or predictors), so the
+//functional mode carries nothing between samples: a drained machine has every RMT entry invalid,
+//and a producer further back than the ROB can hold has already written back. the detailed warmup
+//refills the window and rebuilds RMT validity and the short dependence distances that stall issue
+//
+//IPC is estimated from the mean CPI of the units, with a 95% confidence interval
+
+#define SAMPLE_UNIT     1000
+#define SAMPLE_WARMUP   2000
+#define SAMPLE_Z        1.96    //two-sided 95% normal quantile
+
+typedef struct sample_params{
+    unsigned long period, unit, warmup;
+}sample_params;
+
+typedef struct sample_result{
+    unsigned long long num_instr;   //in the whole trace
+    unsigned long num_samples;
+    double cpi_mean;                //mean cycles per instr. over the measured units
+    double cpi_half;                //half-width of the CPI confidence interval
+}sample_result;
+
+//parse PERIOD[:UNIT[:WARMUP]], returns false on a malformed or impossible schedule
+inline bool parse_sample_params(const char *arg, sample_params &sp){
+    char *q;
+    sp.unit = SAMPLE_UNIT;
+    sp.warmup = SAMPLE_WARMUP;
+    sp.period = strtoul(arg, &q, 10);
+    if(q == arg){
+        return false;
+    }
+    if(*q == ':'){
+        sp.unit = strtoul(q + 1, &q, 10);
+        if(*q == ':'){
+            sp.warmup = strtoul(q + 1, &q, 10);
+        }
+    }
+    return *q == '\0' && sp.unit != 0 && sp.period >= sp.unit + sp.warmup;
+}
+
+//sample the whole trace under one configuration
+inline void Run_Sampled(const proc_params &params, const Op_Table &ops, const sample_params &sp, Trace_Reader &trace,
+        sample_result &res){
+    double sum = 0, sum_sq = 0;
+    res.num_instr = 0;
+    res.num_samples = 0;
+    for(;;){
+        //functional fast-forward
+        uint64_t skip = sp.period - sp.warmup - sp.unit;
+        uint64_t skipped = skip_trace(trace, skip);
+        res.num_instr += skipped;
+        if(skipped < skip){
+            break;
+        }
+
+        //detailed warmup and measurement, stopped as soon as the unit has retired
+        Window_Trace_Reader window(trace, sp.warmup + sp.unit);
+        Sim_State sim(params);
+        sim.ops = ops;
+        step_fn step = Select_Core(sim);
+        int64_t warm_seq = -1;
+        uint64_t warm_cycle = 0;
+        bool running = true;
+        while(running && (unsigned long)sim.seq < sp.warmup + sp.unit){
+            running = step(sim, window);
+            if(warm_seq < 0 && (unsigned long)sim.seq >= sp.warmup){
+                warm_seq = (int64_t)sim.seq;
+                warm_cycle = sim.num_cycles;
+            }
+        }
+        res.num_instr += sp.warmup + sp.unit - window.left;
+        if((unsigned long)sim.seq < sp.warmup + sp.unit){
+            break;      //trace ended inside the sample
+        }
+        double cpi = double(sim.num_cycles - warm_cycle) / double(sim.seq - warm_seq);
+        sum += cpi;
+        sum_sq += cpi * cpi;
+        res.num_samples++;
+    }
+
+    res.cpi_mean = 0;
+    res.cpi_half = 0;
+    if(res.num_samples != 0){
+        res.cpi_mean = sum / res.num_samples;
+    }
+    if(res.num_samples > 1){
+        double var = (sum_sq - sum * res.cpi_mean) / (res.num_samples - 1);
+        res.cpi_half = SAMPLE_Z * sqrt(var > 0 ? var : 0) / sqrt((double)res.num_samples);
+    }
+}
+
+//summary block of a sampled run, the IPC line is followed by its confidence interval
+inline void Print_Sampled_Summary(FILE *out, const proc_params &params, const sample_params &sp, const sample_result &res,
+        const char *trace_file){
+    uint64_t num_cycles = (uint64_t)(res.num_instr * res.cpi_mean + 0.5);
+    Print_Summary(out, params, res.num_instr, num_cycles, trace_file);
+    double lo = 1 / (res.cpi_mean + res.cpi_half);
+    if(res.cpi_mean - res.cpi_half > 0){
+        fprintf(out, "# IPC 95%% Confidence Interval  = [%2.2f, %2.2f]\n", lo, 1 / (res.cpi_mean - res.cpi_half));
+    }
+    else{
+        fprintf(out, "# IPC 95%% Confidence Interval  = [%2.2f, inf]\n", lo);
+    }
+    fprintf(out, "# Samples                      = %lu x %lu instr. (%lu warmup, period %lu)\n", res.num_samples,
+            sp.unit, sp.warmup, sp.period);
+}
+
+#endif
@@ -0,0 +1,287 @@
+#ifndef SIM_SEARCH_H
+#define SIM_SEARCH_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <vector>
+
+#include "sim_proc.h"
+#include "sim_sweep.h"
+
+//Design-Space Search---------------------------------------------------------------------------------------------------
+//
+//./sim --search[=PREFIX[:SLACK]] [--cost=R,Q,W] [--jobs=N] <rob_sizes> <iq_sizes> <widths> <trace_file>
+//
+//approximates the IPC-vs-cost Pareto frontier of the same grid --sweep would run (same list
+//syntax) without simulating all of it. a configuration costs R per ROB entry, Q per IQ entry and W per
+//unit of width (default 1,4,64, a rough area proxy)
+//
+//1. refinement on a prefix: IPC hardly ever drops when ROB_SIZE, IQ_SIZE or WIDTH grows, and
+//   neither does the cost. a box of the grid is simulated on the first PREFIX instr. (default a
+//   tenth of the trace) at its smallest and largest corners; if the largest is within SLACK percent
+//   (default 2) of the smallest, every other point of the box costs more than the smallest for at
+//   most that much more IPC, and is dropped. otherwise the box is halved along its longest side
+//   and both halves refined, starting from the whole grid
+//2. ranking: of the configurations simulated on the prefix, those within SLACK of the prefix
+//   frontier (no cheaper or equally expensive one has more than SLACK more IPC) are kept
+//3. only those are simulated on the whole trace, and their frontier is printed, with the number
+//   of full simulations avoided against the grid
+//
+//the result is within SLACK of the true frontier, not exact: a point dropped in 1. or 2. for
+//being within SLACK of a cheaper one on the prefix can still be on the frontier of the full
+//trace, and then a nearby point is printed in its place. SLACK 0 prunes only boxes whose IPC
+//doesn't grow at all on the prefix
+//
+//a configuration with IQ_SIZE or ROB_SIZE below WIDTH can never dispatch a full bundle and
+//never finishes, so it is left out; a box with one as a corner is always split
+//
+//each round of prefix or full simulations runs on the --sweep thread pool
+
+#define SEARCH_SLACK        2.0     //percent
+#define SEARCH_PREFIX_MIN   10000   //instr., the default prefix is a tenth of the trace but not less
+
+typedef struct search_params{
+    uint64_t prefix;            //0 for the default
+    double slack;               //percent
+    double cost_rob, cost_iq, cost_width;
+}search_params;
+
+typedef struct search_point{
+    proc_params params;
+    double cost;
+    bool runnable;              //IQ_SIZE and ROB_SIZE hold a bundle
+    double prefix_ipc;          //-1 until simulated on the prefix
+    double ipc;                 //-1 until simulated in full
+}search_point;
+
+typedef struct search_result{
+    std::vector<search_point> frontier;    //by increasing cost
+    size_t grid_size, unrunnable, prefix_runs, full_runs;
+    uint64_t prefix;
+    double slack;                           //percent, the frontier is within it of the exact one
+}search_result;
+
+//parse [=PREFIX[:SLACK]] (arg points past "--search") and R,Q,W
+inline bool parse_search_params(const char *arg, search_params &sp){
+    char *q;
+    sp.prefix = 0;
+    sp.slack = SEARCH_SLACK;
+    if(*arg == '\0'){
+        return true;
+    }
+    if(*arg != '='){
+        return false;
+    }
+    sp.prefix = strtoull(arg + 1, &q, 10);
+    if(*q == ':'){
+        const char *p = q + 1;
+        sp.slack = strtod(p, &q);
+        if(q == p){
+            return false;
+        }
+    }
+    return *q == '\0' && sp.slack >= 0;
+}
+inline bool parse_search_cost(const char *arg, search_params &sp){
+    return sscanf(arg, "%lf,%lf,%lf", &sp.cost_rob, &sp.cost_iq, &sp.cost_width) == 3
+            && sp.cost_rob >= 0 && sp.cost_iq >= 0 && sp.cost_width >= 0;
+}
+
+//a box of the grid, inclusive index ranges into the rob, iq and width lists
+typedef struct search_box{
+    size_t lo[3], hi[3];
+}search_box;
+
+class Design_Search{
+public:
+    const Trace_Image &img;
+    const Op_Table &ops;
+    const search_params &sp;
+    unsigned jobs;
+    std::vector<unsigned long> dims[3];     //rob sizes, iq sizes, widths, ascending
+    std::vector<search_point> grid;
+    size_t prefix_runs, full_runs;
+
+    Design_Search(const Trace_Image &i, const Op_Table &o, const search_params &s, unsigned j,
+            const std::vector<unsigned long> &rob_sizes, const std::vector<unsigned long> &iq_sizes,
+            const std::vector<unsigned long> &widths) : img(i), ops(o), sp(s), jobs(j), prefix_runs(0), full_runs(0){
+        dims[0] = rob_sizes;
+        dims[1] = iq_sizes;
+        dims[2] = widths;
+        for(int d = 0; d < 3; d++){
+            std::sort(dims[d].begin(), dims[d].end());
+            dims[d].erase(std::unique(dims[d].begin(), dims[d].end()), dims[d].end());
+        }
+        for(size_t r = 0; r < dims[0].size(); r++){
+            for(size_t q = 0; q < dims[1].size(); q++){
+                for(size_t w = 0; w < dims[2].size(); w++){
+                    search_point pt;
+                    pt.params.rob_size = dims[0][r];
+                    pt.params.iq_size = dims[1][q];
+                    pt.params.width = dims[2][w];
+                    pt.cost = sp.cost_rob * pt.params.rob_size + sp.cost_iq * pt.params.iq_size
+                            + sp.cost_width * pt.params.width;
+                    pt.runnable = runnable_config(pt.params);
+                    pt.prefix_ipc = pt.ipc = -1;
+                    grid.push_back(pt);
+                }
+            }
+        }
+    }
+
+    search_point &at(size_t r, size_t q, size_t w){
+        return grid[(r * dims[1].size() + q) * dims[2].size() + w];
+    }
+
+    //simulate the points of todo on the first len instr., storing IPCs in prefix_ipc or ipc
+    void simulate(const std::vector<search_point *> &todo, uint64_t len, bool full){
+        if(todo.empty()){
+            return;
+        }
+        Trace_Image part;
+        part.records = img.records;
+        part.num_records = len;
+        std::vector<proc_params> configs;
+        for(size_t i = 0; i < todo.size(); i++){
+            configs.push_back(todo[i]->params);
+        }
+        std::vector<sweep_result> results;
+        Run_Sweep(part, configs, ops, jobs, results);
+        for(size_t i = 0; i < todo.size(); i++){
+            double ipc = (results[i].num_cycles != 0) ? double(results[i].num_instr) / results[i].num_cycles : 0;
+            (full ? todo[i]->ipc : todo[i]->prefix_ipc) = ipc;
+        }
+        (full ? full_runs : prefix_runs) += todo.size();
+    }
+
+    //step 1: refine boxes on the prefix, a round of simulations per level
+    void refine(uint64_t prefix){
+        search_box all;
+        for(int d = 0; d < 3; d++){
+            all.lo[d] = 0;
+            all.hi[d] = dims[d].size() - 1;
+        }
+        std::vector<search_box> boxes(1, all);
+        while(!boxes.empty()){
+            std::vector<search_point *> todo;
+            for(size_t b = 0; b < boxes.size(); b++){
+                search_point *corners[2] = {&at(boxes[b].lo[0], boxes[b].lo[1], boxes[b].lo[2]),
+                                            &at(boxes[b].hi[0], boxes[b].hi[1], boxes[b].hi[2])};
+                for(int c = 0; c < 2; c++){
+                    if(corners[c]->runnable && corners[c]->prefix_ipc < 0 && std::find(todo.begin(), todo.end(), corners[c]) == todo.end()){
+                        todo.push_back(corners[c]);
+                    }
+                }
+            }
+            simulate(todo, prefix, false);
+
+            std::vector<search_box> split;
+            for(size_t b = 0; b < boxes.size(); b++){
+                const search_box &box = boxes[b];
+                const search_point &lo = at(box.lo[0], box.lo[1], box.lo[2]), &hi = at(box.hi[0], box.hi[1], box.hi[2]);
+                int d = 0;
+                for(int k = 1; k < 3; k++){
+                    if(box.hi[k] - box.lo[k] > box.hi[d] - box.lo[d]){
+                        d = k;
+                    }
+                }
+                if(box.hi[d] == box.lo[d]
+                        || (lo.runnable && hi.runnable && hi.prefix_ipc <= lo.prefix_ipc * (1 + sp.slack / 100))){
+                    continue;
+                }
+                size_t mid = (box.lo[d] + box.hi[d]) / 2;
+                search_box low = box, high = box;
+                low.hi[d] = mid;
+                high.lo[d] = mid + 1;
+                split.push_back(low);
+                split.push_back(high);
+            }
+            boxes.swap(split);
+        }
+    }
+
+    //step 2: the prefix-simulated points within slack of the prefix frontier
+    void near_frontier(std::vector<search_point *> &keep){
+        std::vector<search_point *> ranked;
+        for(size_t i = 0; i < grid.size(); i++){
+            if(grid[i].prefix_ipc >= 0){
+                ranked.push_back(&grid[i]);
+            }
+        }
+        for(size_t i = 0; i < ranked.size(); i++){
+            bool near = true;
+            for(size_t j = 0; j < ranked.size() && near; j++){
+                near = j == i || ranked[j]->cost > ranked[i]->cost
+                        || ranked[j]->prefix_ipc <= ranked[i]->prefix_ipc * (1 + sp.slack / 100);
+            }
+            if(near){
+                keep.push_back(ranked[i]);
+            }
+        }
+    }
+
+    void run(search_result &res){
+        uint64_t n = img.num_records;
+        uint64_t prefix = sp.prefix != 0 ? sp.prefix : std::max<uint64_t>(n / 10, SEARCH_PREFIX_MIN);
+        if(prefix > n){
+            prefix = n;
+        }
+        refine(prefix);
+        std::vector<search_point *> keep;
+        near_frontier(keep);
+        if(prefix == n){
+            for(size_t i = 0; i < keep.size(); i++){
+                keep[i]->ipc = keep[i]->prefix_ipc;
+            }
+        }
+        else{
+            simulate(keep, n, true);
+        }
+
+        //step 3: the exact frontier of the fully simulated points
+        std::vector<search_point> full;
+        for(size_t i = 0; i < keep.size(); i++){
+            full.push_back(*keep[i]);
+        }
+        std::sort(full.begin(), full.end(), [](const search_point &a, const search_point &b){
+            return a.cost < b.cost || (a.cost == b.cost && a.ipc > b.ipc);
+        });
+        res.frontier.clear();
+        for(size_t i = 0; i < full.size(); i++){
+            if(res.frontier.empty() || full[i].ipc > res.frontier.back().ipc){
+                res.frontier.push_back(full[i]);
+            }
+        }
+        res.grid_size = grid.size();
+        res.unrunnable = 0;
+        for(size_t i = 0; i < grid.size(); i++){
+            res.unrunnable += !grid[i].runnable;
+        }
+        res.prefix_runs = prefix_runs;
+        res.full_runs = (prefix == n) ? prefix_runs : full_runs;
+        res.prefix = prefix;
+        res.slack = sp.slack;
+    }
+};
+
+//the frontier found, which is within res.slack percent of the exact Pareto frontier, not the exact one
+inline void Print_Search(FILE *out, const search_result &res, const char *trace_file){
+    fprintf(out, "# === Pareto Frontier (IPC vs. cost, within %g%% slack) ===\n", res.slack);
+    fprintf(out, "# %s\n", trace_file);
+    fprintf(out, "# %8s %8s %8s %12s %8s\n", "ROB_SIZE", "IQ_SIZE", "WIDTH", "cost", "IPC");
+    for(size_t i = 0; i < res.frontier.size(); i++){
+        const search_point &pt = res.frontier[i];
+        fprintf(out, "  %8lu %8lu %8lu %12.0f %8.2f\n", pt.params.rob_size, pt.params.iq_size, pt.params.width, pt.cost, pt.ipc);
+    }
+    fprintf(out, "# Grid Configurations          = %lu\n", (unsigned long)res.grid_size);
+    if(res.unrunnable != 0){
+        fprintf(out, "# Unrunnable (IQ/ROB < WIDTH)  = %lu\n", (unsigned long)res.unrunnable);
+    }
+    fprintf(out, "# Prefix Simulations           = %lu x %llu instr.\n", (unsigned long)res.prefix_runs,
+            (unsigned long long)res.prefix);
+    fprintf(out, "# Full Simulations             = %lu (%lu avoided)\n", (unsigned long)res.full_runs,
+            (unsigned long)(res.grid_size - res.unrunnable - res.full_runs));
+}
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef SIM_STATS_H
+#define SIM_STATS_H
+
+#include <cstdio>
+#include <stdint.h>
+#include <vector>
+
+//Stall Accounting------------------------------------------------------------------------------------------------------
+//
+//every stage that does nothing in a cycle sets the bit of the reason in Sim_State::stalls;
+//at the end of the cycle the set bits are added to the per-reason counters and the ROB, IQ and
+//execute_list occupancies to their histograms. the event clock weighs an idle cycle by the
+//number of cycles it stands for, so counts match --clock=cycle
+//
+//./sim --stats=FILE ...   writes the counters as JSON, or as CSV if FILE ends in .csv
+
+enum stall_reason{
+    STALL_FE_DE_BUSY,       //Fetch: DE still holds the previous bundle
+    STALL_FE_EOF,           //Fetch: trace exhausted
+    STALL_DE_RN_BUSY,       //Decode: RN still holds the previous bundle
+    STALL_RN_RR_BUSY,       //Rename: RR still holds the previous bundle
+    STALL_RN_ROB_FULL,      //Rename: not enough free ROB entries for the bundle
+    STALL_RR_DI_BUSY,       //RegRead: DI still holds the previous bundle
+    STALL_DI_IQ_FULL,       //Dispatch: not enough free IQ entries for the bundle
+    STALL_IS_NOT_READY,     //Issue: IQ holds entries, none has both sources ready
+    STALL_IS_FU_BUSY,       //Issue: ready entries left waiting for a functional unit
+    STALL_RT_NOT_READY,     //Retire: the ROB head hasn't written back
+    NUM_STALLS
+};
+
+static const char *STALL_NAMES[NUM_STALLS] = {
+    "fetch_decode_busy", "fetch_trace_end", "decode_rename_busy", "rename_regread_busy", "rename_rob_full",
+    "regread_dispatch_busy", "dispatch_iq_full", "issue_none_ready", "issue_fu_busy", "retire_head_not_ready"
+};
+
+class Sim_Stats{
+public:
+    uint64_t stalls[NUM_STALLS];        //cycles each reason held
+    std::vector<uint64_t> rob, iq, execute;   //cycles at each occupancy
+
+    Sim_Stats(unsigned long rob_size, unsigned long iq_size) : rob(rob_size + 1), iq(iq_size + 1), execute(rob_size + 1){
+        for(int i = 0; i < NUM_STALLS; i++){
+            stalls[i] = 0;
+        }
+    }
+
+    //one cycle (or weight identical idle cycles) with the stall bits in mask and the given occupancies
+    inline void account(uint32_t mask, unsigned long rob_occ, unsigned long iq_occ, unsigned long ex_occ, uint64_t weight){
+        for(; mask != 0; mask &= mask - 1){
+            stalls[__builtin_ctz(mask)] += weight;
+        }
+        rob[rob_occ] += weight;
+        iq[iq_occ] += weight;
+        execute[ex_occ] += weight;
+    }
+
+    void write_json(FILE *out, uint64_t num_instr, uint64_t num_cycles) const {
+        fprintf(out, "{\n  \"instructions\": %llu,\n  \"cycles\": %llu,\n  \"stalls\": {",
+                (unsigned long long)num_instr, (unsigned long long)num_cycles);
+        for(int i = 0; i < NUM_STALLS; i++){
+            fprintf(out, "%s\n    \"%s\": %llu", i == 0 ? "" : ",", STALL_NAMES[i], (unsigned long long)stalls[i]);
+        }
+        fprintf(out, "\n  },\n  \"occupancy\": {\n");
+        write_json_hist(out, "rob", rob, false);
+        write_json_hist(out, "iq", iq, false);
+        write_json_hist(out, "execute", execute, true);
+        fprintf(out, "  }\n}\n");
+    }
+    static void write_json_hist(FILE *out, const char *name, const std::vector<uint64_t> &hist, bool last){
+        fprintf(out, "    \"%s\": [", name);
+        for(size_t i = 0; i < hist.size(); i++){
+            fprintf(out, "%s%llu", i == 0 ? "" : ", ", (unsigned long long)hist[i]);
+        }
+        fprintf(out, "]%s\n", last ? "" : ",");
+    }
+
+    //metric,key,value rows: totals, one row per stall reason, one per occupancy level
+    void write_csv(FILE *out, uint64_t num_instr, uint64_t num_cycles) const {
+        fprintf(out, "metric,key,value\n");
+        fprintf(out, "total,instructions,%llu\n", (unsigned long long)num_instr);
+        fprintf(out, "total,cycles,%llu\n", (unsigned long long)num_cycles);
+        for(int i = 0; i < NUM_STALLS; i++){
+            fprintf(out, "stall,%s,%llu\n", STALL_NAMES[i], (unsigned long long)stalls[i]);
+        }
+        write_csv_hist(out, "rob_occupancy", rob);
+        write_csv_hist(out, "iq_occupancy", iq);
+        write_csv_hist(out, "execute_occupancy", execute);
+    }
+    static void write_csv_hist(FILE *out, const char *name, const std::vector<uint64_t> &hist){
+        for(size_t i = 0; i < hist.size(); i++){
+            fprintf(out, "%s,%zu,%llu\n", name, i, (unsigned long long)hist[i]);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,117 @@
+#ifndef SIM_SWEEP_H
+#define SIM_SWEEP_H
+
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "sim_proc.h"
+
+//Parameter Sweep-------------------------------------------------------------------------------------------------------
+//
+//./sim --sweep [--jobs=N] <rob_sizes> <iq_sizes> <widths> <trace_file>
+//
+//each list is comma separated; an item is a single value or a range
+//  lo:hi        every value from lo to hi
+//  lo:hi:step   lo, lo+step, ... up to hi
+//  lo:hi:xN     lo, lo*N, lo*N*N, ... up to hi
+//e.g. --sweep 32:512:x2 16,32,64 1:8 gcc_trace.txt
+//
+//the trace is decoded once and shared read-only by a pool of worker threads,
+//one summary per configuration is printed in rob/iq/width order. a configuration whose
+//IQ or ROB can't hold a bundle of WIDTH instr. would never dispatch it, so it is skipped
+//and only counted
+
+typedef struct sweep_result{
+    proc_params params;
+    uint64_t num_instr, num_cycles;
+}sweep_result;
+
+//IQ_SIZE and ROB_SIZE hold a whole bundle, so the configuration can drain its trace
+inline bool runnable_config(const proc_params &params){
+    return params.iq_size >= params.width && params.rob_size >= params.width;
+}
+
+//parse one list argument into vals, returns false on a malformed list
+inline bool parse_param_list(const char *arg, std::vector<unsigned long> &vals){
+    const char *p = arg;
+    while(*p != '\0'){
+        char *q;
+        unsigned long lo = strtoul(p, &q, 10), hi = lo, step = 1;
+        bool scale = false;
+        if(q == p || lo == 0){
+            return false;
+        }
+        p = q;
+        if(*p == ':'){
+            hi = strtoul(p + 1, &q, 10);
+            if(q == p + 1 || hi < lo){
+                return false;
+            }
+            p = q;
+            if(*p == ':'){
+                p++;
+                if(*p == 'x'){
+                    scale = true;
+                    p++;
+                }
+                step = strtoul(p, &q, 10);
+                if(q == p || step == 0 || (scale && step < 2)){
+                    return false;
+                }
+                p = q;
+            }
+        }
+        //stop before the next value passes hi, it could wrap around past ULONG_MAX
+        for(unsigned long v = lo; ; v = scale ? v * step : v + step){
+            vals.push_back(v);
+            if(scale ? v > hi / step : hi - v < step){
+                break;
+            }
+        }
+        if(*p == ','){
+            p++;
+        }
+        else if(*p != '\0'){
+            return false;
+        }
+    }
+    return !vals.empty();
+}
+
+//simulate every config over img on jobs worker threads, results[i] belongs to configs[i]
+inline void Run_Sweep(const Trace_Image &img, const std::vector<proc_params> &configs, const Op_Table &ops, unsigned jobs,
+        std::vector<sweep_result> &results){
+    results.resize(configs.size());
+    std::atomic<size_t> next_config(0);
+    if(jobs == 0){
+        jobs = std::thread::hardware_concurrency();
+    }
+    if(jobs == 0 || jobs > configs.size()){
+        jobs = configs.size();
+    }
+
+    //workers claim configs one at a time until the list is exhausted
+    std::vector<std::thread> workers;
+    for(unsigned t = 0; t < jobs; t++){
+        workers.push_back(std::thread([&](){
+            for(size_t i = next_config++; i < configs.size(); i = next_config++){
+                Memory_Trace_Reader trace(img.records, img.num_records);
+                Sim_State sim(configs[i]);
+                sim.timing_out = NULL;
+                sim.ops = ops;
+                Simulate(sim, trace);
+                results[i].params = configs[i];
+                results[i].num_instr = sim.num_instr;
+                results[i].num_cycles = sim.num_cycles;
+            }
+        }));
+    }
+    for(unsigned t = 0; t < workers.size(); t++){
+        workers[t].join();
+    }
+}
+
+#endif
@@ -0,0 +1,199 @@
+#ifndef SIM_TELEMETRY_H
+#define SIM_TELEMETRY_H
+
+#include <cstdio>
+#include <cstring>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "sim_proc.h"
+
+//Telemetry-------------------------------------------------------------------------------------------------------------
+//
+//./sim --telemetry=FILE [--telemetry-period=MS] ...         snapshots written to FILE
+//./sim --telemetry=unix:PATH [--telemetry-period=MS] ...    sent to a listening UNIX stream socket
+//
+//every MS milliseconds (default 1000) and once at the end, one JSON line:
+//  {"time": 2.001, "cycles": ..., "retired": ..., "ipc": ..., "rob": ..., "iq": ..., "mips": ...,
+//   "trace_pos": ..., "trace_len": ..., "done": false}
+//  time        wall seconds since the run started
+//  ipc         instr. retired per cycle since the previous snapshot
+//  rob, iq     occupancy at the snapshot
+//  mips        million instr. retired per wall second since the previous snapshot
+//  trace_pos   instr. read from the trace so far; trace_len is the trace's length if its header
+//              gives one (binary traces), else 0
+//
+//the simulation thread never blocks on telemetry: every TELEMETRY_STEPS steps it copies a few
+//counters into a Telemetry_Block under a seqlock, and a side thread reads the block (retrying if
+//it raced a write), formats and sends the line. a sink that goes away just ends the stream
+
+#define TELEMETRY_STEPS     1024    //steps between publishes, a power of 2
+#define TELEMETRY_PERIOD    1000    //ms
+
+//counters published by the simulation thread
+class Telemetry_Block{
+public:
+    std::atomic<uint32_t> version;      //odd while a write is in progress
+    std::atomic<uint64_t> cycles, retired, fetched, rob, iq;
+
+    Telemetry_Block() : version(0), cycles(0), retired(0), fetched(0), rob(0), iq(0){}
+
+    void publish(const Sim_State &sim){
+        uint32_t v = version.load(std::memory_order_relaxed);
+        version.store(v + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        cycles.store(sim.num_cycles, std::memory_order_relaxed);
+        retired.store(sim.seq, std::memory_order_relaxed);
+        fetched.store(sim.num_instr, std::memory_order_relaxed);
+        rob.store(sim.ROB_table.count, std::memory_order_relaxed);
+        iq.store(sim.issueQueue.count, std::memory_order_relaxed);
+        version.store(v + 2, std::memory_order_release);
+    }
+};
+
+typedef struct telemetry_snapshot{
+    uint64_t cycles, retired, fetched, rob, iq;
+}telemetry_snapshot;
+
+class Telemetry{
+public:
+    Telemetry_Block block;
+    int fd;
+    bool socket_sink;
+    unsigned long period_ms;
+    unsigned long steps;                //simulation thread only
+    uint64_t trace_len;
+    std::thread reporter;
+    std::mutex lock;                    //only guards stop, for the reporter's timed wait
+    std::condition_variable wake;
+    bool stop;
+    std::chrono::steady_clock::time_point start;
+
+    Telemetry() : fd(-1), socket_sink(false), period_ms(TELEMETRY_PERIOD), steps(0), trace_len(0), stop(false){}
+    ~Telemetry(){
+        finish();
+        if(fd >= 0){
+            close(fd);
+        }
+    }
+
+    //connect to unix:PATH or create FILE, returns false if the sink can't be opened
+    bool open(const char *dest){
+        if(strncmp(dest, "unix:", 5) == 0){
+            struct sockaddr_un addr;
+            memset(&addr, 0, sizeof(addr));
+            addr.sun_family = AF_UNIX;
+            if(strlen(dest + 5) >= sizeof(addr.sun_path)){
+                return false;
+            }
+            strcpy(addr.sun_path, dest + 5);
+            socket_sink = true;
+            fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            if(fd >= 0 && connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0){
+                close(fd);
+                fd = -1;
+            }
+        }
+        else{
+            fd = ::open(dest, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        }
+        return fd >= 0;
+    }
+
+    //start the reporter thread from sim's current (possibly resumed) state; the final snapshot is sent by finish()
+    void begin(const Sim_State &sim){
+        start = std::chrono::steady_clock::now();
+        block.publish(sim);
+        reporter = std::thread([this](){
+            telemetry_snapshot prev;
+            read(prev);
+            double prev_time = 0;
+            std::unique_lock<std::mutex> guard(lock);
+            while(!wake.wait_for(guard, std::chrono::milliseconds(period_ms), [this](){ return stop; })){
+                report(prev, prev_time, false);
+            }
+        });
+    }
+
+    //the simulation thread, every TELEMETRY_STEPS steps
+    inline void tick(const Sim_State &sim){
+        if((++steps & (TELEMETRY_STEPS - 1)) == 0){
+            block.publish(sim);
+        }
+    }
+
+    //publish the final state, stop the reporter and send the last snapshot, its rates over the whole run
+    void finish(const Sim_State *sim = NULL){
+        if(!reporter.joinable()){
+            return;
+        }
+        if(sim != NULL){
+            block.publish(*sim);
+        }
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stop = true;
+        }
+        wake.notify_one();
+        reporter.join();
+        telemetry_snapshot prev;
+        memset(&prev, 0, sizeof(prev));
+        double prev_time = 0;
+        report(prev, prev_time, true);
+    }
+
+    void read(telemetry_snapshot &s){
+        uint32_t v;
+        do {
+            while((v = block.version.load(std::memory_order_acquire)) & 1){
+                std::this_thread::yield();
+            }
+            s.cycles = block.cycles.load(std::memory_order_relaxed);
+            s.retired = block.retired.load(std::memory_order_relaxed);
+            s.fetched = block.fetched.load(std::memory_order_relaxed);
+            s.rob = block.rob.load(std::memory_order_relaxed);
+            s.iq = block.iq.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while(block.version.load(std::memory_order_relaxed) != v);
+    }
+
+    //send one line; rates are over the time since prev (the whole run for the final one)
+    void report(telemetry_snapshot &prev, double &prev_time, bool done){
+        if(fd < 0){
+            return;
+        }
+        telemetry_snapshot cur;
+        read(cur);
+        double now = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        uint64_t d_cycles = cur.cycles - prev.cycles, d_retired = cur.retired - prev.retired;
+        char line[512];
+        int len = snprintf(line, sizeof(line), "{\"time\": %.3f, \"cycles\": %llu, \"retired\": %llu, \"ipc\": %.4f, "
+                "\"rob\": %llu, \"iq\": %llu, \"mips\": %.3f, \"trace_pos\": %llu, \"trace_len\": %llu, \"done\": %s}\n",
+                now, (unsigned long long)cur.cycles, (unsigned long long)cur.retired,
+                d_cycles != 0 ? double(d_retired) / d_cycles : 0.0, (unsigned long long)cur.rob, (unsigned long long)cur.iq,
+                now > prev_time ? d_retired / (now - prev_time) / 1e6 : 0.0, (unsigned long long)cur.fetched,
+                (unsigned long long)trace_len, done ? "true" : "false");
+        ssize_t n = socket_sink ? send(fd, line, len, MSG_NOSIGNAL) : write(fd, line, len);
+        if(n != len){
+            close(fd);      //the sink is gone, the run goes on without it
+            fd = -1;
+        }
+        prev = cur;
+        prev_time = now;
+    }
+};
+
+//length of a binary trace from its header, 0 for other traces
+inline uint64_t trace_length(const Trace_Reader *trace){
+    const Binary_Trace_Reader *binary = dynamic_cast<const Binary_Trace_Reader *>(trace);
+    return binary != NULL ? binary->last - (const trace_record *)((const trace_header *)binary->map + 1) : 0;
+}
+
+#endif
@@ -0,0 +1,99 @@
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "libsim.h"
+#include "sim_sweep.h"
+
+/*  Regression tests for cases the validation runs in validation/ don't reach, "make test" builds
+    and runs them. Each check that fails prints its line; the exit status is the number of failures.
+*/
+
+int failures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) \
+        { \
+            printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            failures++; \
+        } \
+    } while (0)
+
+//a configuration that can never dispatch a bundle is refused, and doesn't hang
+void Test_Rejected_Configs()
+{
+    static const unsigned long bad[][3] = {{64, 16, 0}, {64, 2, 4}, {2, 16, 4}};
+    std::vector<trace_record> records(100);
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        records[i].pc = 0x1000 + 4 * i;
+        records[i].op_type = 0;
+        records[i].dst = records[i].src1 = records[i].src2 = -1;
+    }
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++)
+    {
+        proc_params params;
+        params.rob_size = bad[i][0];
+        params.iq_size  = bad[i][1];
+        params.width    = bad[i][2];
+        Simulator sim(params);
+        CHECK(!sim.ok());
+        CHECK(sim.done());
+        sim.push(records);
+        CHECK(sim.step(1000) == 0);
+        sim.run_to_completion();
+        CHECK(sim.stats().num_cycles == 0);
+    }
+    proc_params params;
+    params.rob_size = 4;
+    params.iq_size  = 4;
+    params.width    = 4;
+    Simulator sim(params);
+    CHECK(sim.ok());
+    sim.push(records);
+    sim.run_to_completion();
+    CHECK(sim.stats().num_retired == records.size());
+}
+
+//sweep lists, including ranges whose next value would overflow an unsigned long
+void Test_Param_Lists()
+{
+    std::vector<unsigned long> vals;
+    CHECK(parse_param_list("1:10:3,16:64:x2", vals));
+    static const unsigned long expect[] = {1, 4, 7, 10, 16, 32, 64};
+    CHECK(vals == std::vector<unsigned long>(expect, expect + 7));
+
+    char max[32];
+    snprintf(max, sizeof(max), "%lu", ULONG_MAX);
+    vals.clear();
+    CHECK(parse_param_list(("1:" + std::string(max) + ":x2").c_str(), vals));
+    CHECK(vals.size() == sizeof(unsigned long) * CHAR_BIT);
+    CHECK(!vals.empty() && vals.back() == ULONG_MAX / 2 + 1);
+
+    vals.clear();
+    CHECK(parse_param_list((std::to_string(ULONG_MAX - 5) + ":" + max + ":4").c_str(), vals));
+    CHECK(vals.size() == 2 && vals[1] == ULONG_MAX - 1);
+
+    vals.clear();
+    CHECK(parse_param_list((std::string(max) + ":" + max + ":x3").c_str(), vals));
+    CHECK(vals.size() == 1 && vals[0] == ULONG_MAX);
+
+    vals.clear();
+    CHECK(!parse_param_list("0:8", vals));
+    CHECK(!parse_param_list("8:4", vals));
+    CHECK(!parse_param_list("1:8:x1", vals));
+}
+
+int main()
+{
+    Test_Param_Lists();
+    Test_Rejected_Configs();
+    if (failures != 0)
+        printf("# %d checks failed\n", failures);
+    else
+        printf("# all checks passed\n");
+    return failures;
+}
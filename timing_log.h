@@ -0,0 +1,230 @@
+#ifndef TIMING_LOG_H
+#define TIMING_LOG_H
+
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+#include <vector>
+
+//Per-Instruction Timing Output-----------------------------------------------------------------------------------------
+//
+//text:    "<seq_no> fu{<op_type>} src{<src1>,<src2>} dst{<dst>} FE{<begin-cycle>,<duration>} ... RT{...}"
+//         one line per retired instr., as in validation/val*.txt
+//binary:  timing_log_header followed by one variable-length record per retired instr.:
+//         varint  FE begin minus the previous instr.'s FE begin (instr. are fetched in order)
+//         varint  op_type, src1+1, src2+1, dst+1
+//         varint  duration of each of the 9 stages
+//         every other begin cycle is the previous stage's begin plus its duration
+//none:    summary only, nothing is formatted per instr.
+//
+//a binary log written to a file gets a companion index, <log>.idx: a timing_log_header followed
+//by a timing_seek_point every TIMING_SEEK_INTERVAL instr. retirement is in program order, so
+//both the seq. number and the retire cycle grow monotonically through the index and a viewer
+//(scope) can binary search it and decode from the nearest seek point instead of the start
+
+#define TIMING_MAGIC        "SIMTIMES"
+#define TIMING_MAGIC_LEN    8
+#define TIMING_VERSION      1
+#define TIMING_INDEX_MAGIC  "SIMTMIDX"
+#define TIMING_SEEK_INTERVAL 1024
+
+#define NUM_STAGES  9
+enum { STAGE_FE, STAGE_DE, STAGE_RN, STAGE_RR, STAGE_DI, STAGE_IS, STAGE_EX, STAGE_WB, STAGE_RT };
+static const char STAGE_NAMES[NUM_STAGES][3] = {"FE", "DE", "RN", "RR", "DI", "IS", "EX", "WB", "RT"};
+
+enum timing_format { TIMING_TEXT, TIMING_BINARY, TIMING_NONE };
+
+typedef struct timing_log_header{
+    char magic[TIMING_MAGIC_LEN];
+    uint32_t version;
+    uint32_t reserved;
+}timing_log_header;
+
+//where decoding can start: the record of instr. seq begins at byte offset of the log
+typedef struct timing_seek_point{
+    uint64_t seq;
+    uint64_t offset;
+    int64_t prev_fetch;     //FE begin of instr. seq-1, the base of the record's delta
+    int64_t retire;         //last cycle instr. seq spends in RT
+}timing_seek_point;
+
+//timing of one retired instr.
+typedef struct timing_record{
+    uint64_t seq;
+    int op_type, src1, src2, dst;
+    int64_t begin[NUM_STAGES];
+    int cycles[NUM_STAGES];
+}timing_record;
+
+//buffered writer, formats records into a large buffer and hands full buffers to the FILE
+class Timing_Writer{
+public:
+    static const size_t BUF_SIZE = 1 << 20;
+    static const size_t MAX_RECORD = 256;   //longest text line or binary record
+    FILE *FP;               //NULL once the owner has closed it, nothing more is written
+    FILE *index;            //binary: seek points, NULL for none
+    timing_format format;
+    std::vector<char> buf;
+    size_t len;
+    int64_t prev_fetch;     //binary: FE begin of the previous record
+    unsigned long long written;   //bytes handed to FP
+
+    //resume_offset != 0 continues output already written up to that offset (see sim_checkpoint.h),
+    //the binary log's last record was fetched at resume_fetch
+    Timing_Writer(FILE *fp, timing_format fmt, FILE *idx = NULL, unsigned long long resume_offset = 0, int64_t resume_fetch = 0)
+            : FP(fp), index(idx), format(fmt), buf(BUF_SIZE), len(0), prev_fetch(resume_fetch), written(resume_offset){
+        if(format == TIMING_BINARY && resume_offset == 0){
+            timing_log_header hdr;
+            memset(&hdr, 0, sizeof(hdr));
+            memcpy(hdr.magic, TIMING_MAGIC, TIMING_MAGIC_LEN);
+            hdr.version = TIMING_VERSION;
+            memcpy(&buf[0], &hdr, sizeof(hdr));
+            len = sizeof(hdr);
+            if(index != NULL){
+                memcpy(hdr.magic, TIMING_INDEX_MAGIC, TIMING_MAGIC_LEN);
+                fwrite(&hdr, sizeof(hdr), 1, index);
+            }
+        }
+    }
+    ~Timing_Writer(){ flush(); }
+
+    void flush(){
+        if(FP == NULL){
+            return;
+        }
+        if(len != 0){
+            fwrite(&buf[0], 1, len, FP);
+            written += len;
+            len = 0;
+        }
+        fflush(FP);
+        if(index != NULL){
+            fflush(index);
+        }
+    }
+
+    void put(const timing_record &rec){
+        if(format == TIMING_NONE){
+            return;
+        }
+        if(len + MAX_RECORD > BUF_SIZE){
+            fwrite(&buf[0], 1, len, FP);
+            written += len;
+            len = 0;
+        }
+        char *p = &buf[len];
+        if(format == TIMING_TEXT){
+            p = put_int(p, rec.seq);
+            p = put_str(p, " fu{", 4);
+            p = put_int(p, rec.op_type);
+            p = put_str(p, "} src{", 6);
+            p = put_int(p, rec.src1);
+            *p++ = ',';
+            p = put_int(p, rec.src2);
+            p = put_str(p, "} dst{", 6);
+            p = put_int(p, rec.dst);
+            *p++ = '}';
+            for(int s = 0; s < NUM_STAGES; s++){
+                *p++ = ' ';
+                *p++ = STAGE_NAMES[s][0];
+                *p++ = STAGE_NAMES[s][1];
+                *p++ = '{';
+                p = put_int(p, rec.begin[s]);
+                *p++ = ',';
+                p = put_int(p, rec.cycles[s]);
+                *p++ = '}';
+            }
+            *p++ = '\n';
+        }
+        else{
+            if(index != NULL && rec.seq % TIMING_SEEK_INTERVAL == 0){
+                timing_seek_point sp;
+                sp.seq = rec.seq;
+                sp.offset = written + len;
+                sp.prev_fetch = prev_fetch;
+                sp.retire = rec.begin[STAGE_RT] + rec.cycles[STAGE_RT] - 1;
+                fwrite(&sp, sizeof(sp), 1, index);
+            }
+            p = put_varint(p, rec.begin[STAGE_FE] - prev_fetch);
+            prev_fetch = rec.begin[STAGE_FE];
+            p = put_varint(p, rec.op_type);
+            p = put_varint(p, rec.src1 + 1);
+            p = put_varint(p, rec.src2 + 1);
+            p = put_varint(p, rec.dst + 1);
+            for(int s = 0; s < NUM_STAGES; s++){
+                p = put_varint(p, rec.cycles[s]);
+            }
+        }
+        len = p - &buf[0];
+    }
+
+    //bytes of output so far, including what is still buffered
+    unsigned long long offset() const { return written + len; }
+
+    static inline char *put_str(char *p, const char *s, size_t n){
+        memcpy(p, s, n);
+        return p + n;
+    }
+    static inline char *put_int(char *p, long long v){
+        if(v < 0){
+            *p++ = '-';
+            v = -v;
+        }
+        char digits[20];
+        int n = 0;
+        do {
+            digits[n++] = '0' + v % 10;
+            v /= 10;
+        } while(v != 0);
+        while(n != 0){
+            *p++ = digits[--n];
+        }
+        return p;
+    }
+    static inline char *put_varint(char *p, uint32_t v){
+        while(v >= 0x80){
+            *p++ = (char)(v | 0x80);
+            v >>= 7;
+        }
+        *p++ = (char)v;
+        return p;
+    }
+};
+
+//read one varint, returns NULL if it runs past e
+inline const char *get_varint(const char *p, const char *e, uint32_t &v){
+    v = 0;
+    for(int shift = 0; p < e && shift < 35; shift += 7){
+        uint8_t b = *p++;
+        v |= (uint32_t)(b & 0x7f) << shift;
+        if((b & 0x80) == 0){
+            return p;
+        }
+    }
+    return NULL;
+}
+
+//decode one binary record that follows the record fetched at prev_fetch, returns NULL on a short/corrupt record
+inline const char *get_timing_record(const char *p, const char *e, uint64_t seq, int64_t prev_fetch, timing_record &rec){
+    uint32_t v[5 + NUM_STAGES];
+    for(int i = 0; i < 5 + NUM_STAGES; i++){
+        if((p = get_varint(p, e, v[i])) == NULL){
+            return NULL;
+        }
+    }
+    rec.seq = seq;
+    rec.begin[STAGE_FE] = prev_fetch + v[0];
+    rec.op_type = v[1];
+    rec.src1 = (int)v[2] - 1;
+    rec.src2 = (int)v[3] - 1;
+    rec.dst = (int)v[4] - 1;
+    for(int s = 0; s < NUM_STAGES; s++){
+        rec.cycles[s] = v[5 + s];
+        if(s != 0){
+            rec.begin[s] = rec.begin[s - 1] + rec.cycles[s - 1];
+        }
+    }
+    return p;
+}
+
+#endif
@@ -0,0 +1,65 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "trace_io.h"
+
+/*  Converts a text trace (optionally gzip/xz compressed) into the pre-decoded binary
+    trace format read by sim
+
+    Example:-
+    trace_conv val_trace_gcc1 val_trace_gcc1.bin
+    argv[1] = text trace (input)
+    argv[2] = binary trace (output)
+*/
+
+int main (int argc, char* argv[])
+{
+    if (argc != 3)
+    {
+        printf("Error: Wrong number of inputs:%d\n", argc-1);
+        printf("Usage: %s <text trace> <binary trace>\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    Trace_Reader *in = open_trace(argv[1]);
+    if(in == NULL)
+    {
+        printf("Error: Unable to open file %s\n", argv[1]);
+        exit(EXIT_FAILURE);
+    }
+    FILE *out = fopen(argv[2], "wb");
+    if(out == NULL)
+    {
+        printf("Error: Unable to open file %s\n", argv[2]);
+        exit(EXIT_FAILURE);
+    }
+
+    //header is rewritten with the record count once the input is consumed
+    trace_header hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, TRACE_MAGIC, TRACE_MAGIC_LEN);
+    hdr.version = TRACE_VERSION;
+    hdr.record_size = sizeof(trace_record);
+    fwrite(&hdr, sizeof(hdr), 1, out);
+
+    do {
+        size_t n = in->end - in->cur;
+        if(fwrite(in->cur, sizeof(trace_record), n, out) != n){
+            printf("Error: Unable to write file %s\n", argv[2]);
+            exit(EXIT_FAILURE);
+        }
+        hdr.num_records += n;
+    } while(in->refill());
+    delete in;
+
+    rewind(out);
+    fwrite(&hdr, sizeof(hdr), 1, out);
+    if(fclose(out) != 0){
+        printf("Error: Unable to write file %s\n", argv[2]);
+        exit(EXIT_FAILURE);
+    }
+    printf("%s: %llu instructions\n", argv[2], (unsigned long long)hdr.num_records);
+
+    return 0;
+}
@@ -0,0 +1,219 @@
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "trace_io.h"
+
+/*  Generates a synthetic trace of any length, for benchmarking the simulator on traces far
+    longer than the ones in proj3-traces. Each instr. independently draws its
+      op type       from the --mix weights
+      dst           a random register, or none (-1)
+      src1, src2    none, or the dst of an instr. d back, with the dependency distance d drawn
+                    from the --dep distribution (a random register if that instr. had no dst)
+    a later instr. may overwrite the register in between, so the true distance is at most d
+
+    Example:-
+    trace_gen 10000000 bench.bin
+    trace_gen --mix=50,30,20 --dep=4 --seed=7 100000000 bench.bin
+    trace_gen --dep=1:64 --text 10000 small.txt
+
+    Options:-
+    --mix=W0,W1,...     relative weight of op types 0,1,... (default 70,10,20)
+    --dep=M             geometric dependency distances with mean M (default 8)
+    --dep=LO:HI         uniform dependency distances in [LO, HI]
+    --srcs=P1,P2        percent of instr. with a src1 / src2 (default 85,40)
+    --dst=P             percent of instr. with a dst (default 90)
+    --seed=N            random seed (default 1)
+    --text              write a text trace instead of a binary one
+*/
+
+#define NUM_REGS    64
+#define HISTORY     4096        //longest dependency distance, a power of 2
+#define BLOCK       65536       //records written at a time
+
+//xorshift64*, fast and good enough for trace statistics
+class Random{
+public:
+    uint64_t s;
+    Random(uint64_t seed) : s(seed * 0x9E3779B97F4A7C15ULL + 1){}
+    uint64_t next(){
+        s ^= s >> 12;
+        s ^= s << 25;
+        s ^= s >> 27;
+        return s * 0x2545F4914F6CDD1DULL;
+    }
+    //uniform in [0, 1)
+    double real(){ return (next() >> 11) * (1.0 / 9007199254740992.0); }
+    unsigned long below(unsigned long n){ return next() % n; }
+};
+
+int main (int argc, char* argv[])
+{
+    std::vector<double> mix;
+    double dep_mean = 8;
+    unsigned long dep_lo = 0, dep_hi = 0;     //uniform distances when dep_hi != 0
+    int src1_pct = 85, src2_pct = 40, dst_pct = 90;
+    uint64_t seed = 1;
+    bool text = false;
+    int argi = 1;
+
+    while (argi < argc && strncmp(argv[argi], "--", 2) == 0)
+    {
+        char *p = strchr(argv[argi], '=');
+        if (strncmp(argv[argi], "--mix=", 6) == 0)
+        {
+            for (p++; *p != '\0'; p += (*p == ','))
+            {
+                char *q;
+                mix.push_back(strtod(p, &q));
+                if (q == p || mix.back() < 0)
+                {
+                    printf("Error: Malformed op mix %s\n", argv[argi] + 6);
+                    exit(EXIT_FAILURE);
+                }
+                p = q;
+            }
+        }
+        else if (strncmp(argv[argi], "--dep=", 6) == 0)
+        {
+            if (strchr(p, ':') != NULL)
+            {
+                dep_lo = strtoul(p + 1, &p, 10);
+                dep_hi = strtoul(p + 1, NULL, 10);
+            }
+            else
+                dep_mean = strtod(p + 1, NULL);
+            if ((dep_hi == 0 && dep_mean < 1) || (dep_hi != 0 && (dep_lo < 1 || dep_lo > dep_hi)) || dep_hi >= HISTORY)
+            {
+                printf("Error: Dependency distances must be within 1 to %d\n", HISTORY - 1);
+                exit(EXIT_FAILURE);
+            }
+        }
+        else if (strncmp(argv[argi], "--srcs=", 7) == 0)
+            sscanf(p + 1, "%d,%d", &src1_pct, &src2_pct);
+        else if (strncmp(argv[argi], "--dst=", 6) == 0)
+            dst_pct = atoi(p + 1);
+        else if (strncmp(argv[argi], "--seed=", 7) == 0)
+            seed = strtoull(p + 1, NULL, 10);
+        else if (strcmp(argv[argi], "--text") == 0)
+            text = true;
+        else
+        {
+            printf("Error: Unknown option %s\n", argv[argi]);
+            exit(EXIT_FAILURE);
+        }
+        argi++;
+    }
+    if (argc - argi != 2)
+    {
+        printf("Error: Wrong number of inputs:%d\n", argc-argi);
+        printf("Usage: %s [options] <num instructions> <trace>\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    uint64_t count = strtoull(argv[argi], NULL, 10);
+    const char *out_file = argv[argi+1];
+    if (mix.empty())
+    {
+        mix.push_back(70);
+        mix.push_back(10);
+        mix.push_back(20);
+    }
+
+    //cumulative op mix
+    double total = 0;
+    for (size_t i = 0; i < mix.size(); i++)
+        total += mix[i];
+    if (total <= 0)
+    {
+        printf("Error: Malformed op mix\n");
+        exit(EXIT_FAILURE);
+    }
+    std::vector<double> cdf(mix.size());
+    double acc = 0;
+    for (size_t i = 0; i < mix.size(); i++)
+        cdf[i] = (acc += mix[i]) / total;
+
+    FILE *out = fopen(out_file, "wb");
+    if (out == NULL)
+    {
+        printf("Error: Unable to open file %s\n", out_file);
+        exit(EXIT_FAILURE);
+    }
+    trace_header hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, TRACE_MAGIC, TRACE_MAGIC_LEN);
+    hdr.version = TRACE_VERSION;
+    hdr.record_size = sizeof(trace_record);
+    hdr.num_records = count;
+    if (!text)
+        fwrite(&hdr, sizeof(hdr), 1, out);
+
+    Random rng(seed);
+    int16_t history[HISTORY];       //dst of the last HISTORY instr., -1 for none
+    for (int i = 0; i < HISTORY; i++)
+        history[i] = -1;
+    //geometric distances: d = 1 + floor(log(u) / log(1 - 1/mean))
+    double log_q = (dep_mean > 1) ? log(1 - 1 / dep_mean) : 0;
+    std::vector<trace_record> block(BLOCK);
+    uint64_t pc = 0x400000;
+
+    for (uint64_t n = 0; n < count; )
+    {
+        size_t len = (count - n < BLOCK) ? count - n : BLOCK;
+        for (size_t b = 0; b < len; b++, n++)
+        {
+            trace_record &rec = block[b];
+            rec.pc = pc;
+            pc += 4;
+            double u = rng.real();
+            rec.op_type = 0;
+            while (rec.op_type + 1 < (int)cdf.size() && u >= cdf[rec.op_type])
+                rec.op_type++;
+            int16_t *srcs[2] = {&rec.src1, &rec.src2};
+            int pcts[2] = {src1_pct, src2_pct};
+            for (int s = 0; s < 2; s++)
+            {
+                *srcs[s] = -1;
+                if ((int)rng.below(100) >= pcts[s])
+                    continue;
+                unsigned long d;
+                if (dep_hi != 0)
+                    d = dep_lo + rng.below(dep_hi - dep_lo + 1);
+                else if (log_q == 0)
+                    d = 1;
+                else
+                {
+                    double r = 1 - rng.real();
+                    d = 1 + (unsigned long)(log(r) / log_q);
+                    if (d >= HISTORY)
+                        d = HISTORY - 1;
+                }
+                int16_t reg = (d <= n) ? history[(n - d) & (HISTORY - 1)] : -1;
+                *srcs[s] = (reg >= 0) ? reg : (int16_t)rng.below(NUM_REGS);
+            }
+            rec.dst = ((int)rng.below(100) < dst_pct) ? (int16_t)rng.below(NUM_REGS) : -1;
+            history[n & (HISTORY - 1)] = rec.dst;
+        }
+        if (text)
+        {
+            for (size_t b = 0; b < len; b++)
+                fprintf(out, "%llx %d %d %d %d\n", (unsigned long long)block[b].pc, block[b].op_type, block[b].dst,
+                        block[b].src1, block[b].src2);
+        }
+        else if (fwrite(&block[0], sizeof(trace_record), len, out) != len)
+        {
+            printf("Error: Unable to write file %s\n", out_file);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (fclose(out) != 0)
+    {
+        printf("Error: Unable to write file %s\n", out_file);
+        exit(EXIT_FAILURE);
+    }
+    printf("%s: %llu instructions\n", out_file, (unsigned long long)count);
+
+    return 0;
+}
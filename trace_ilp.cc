@@ -0,0 +1,176 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "sim_proc.h"
+#include "sim_sweep.h"
+
+/*  Dataflow-limit analyzer: one streaming pass over a trace gives the critical path length of its
+    register dataflow graph and the IPC an ideal machine with a W-instruction window reaches, for a
+    list of window sizes. Orders of magnitude cheaper than simulating, for pruning sweeps.
+
+    Example:-
+    trace_ilp gcc_trace.bin
+    trace_ilp --windows=16,64:1024:x2 --fu-config=op_classes.cfg gcc_trace.txt
+    trace_ilp --csv=gcc_ilp.csv gcc_trace.xz
+
+    --windows=LIST    window sizes, in the --sweep list syntax (default 4:4096:x2)
+    --fu-config=FILE  op latencies, as for sim (FU counts are ignored: the machine has no structural limits)
+    --csv=FILE        also write the curve as window,cycles,ipc rows (window 0 is unbounded)
+
+    The ideal machine has sim's dependences: a source waits for the latest earlier instr. writing
+    its register (true dependences only, renaming removes the rest), and an instr. finishes op
+    latency cycles after its last source. Fetch, decode and issue are unlimited; with a window of W
+    an instr. enters once the instr. W before it has retired, in order. The unbounded window's run
+    time is the critical path. Every stage of sim only adds delay, so for any IQ_SIZE and WIDTH
+
+        sim IPC  <=  min(WIDTH, IPC at window ROB_SIZE)
+
+    and a configuration whose bound is below an IPC already reached can be skipped.
+*/
+
+#define NUM_ARCH_REGS 67
+
+//timing of the ideal machine with one window size
+typedef struct window_model{
+    unsigned long size;                 //0 for unbounded
+    std::vector<uint64_t> retired;      //ring: retire cycle of the last size instr.
+    unsigned long next;                 //ring slot of the current instr.
+    uint64_t ready[NUM_ARCH_REGS];      //cycle each register's latest value is produced
+    uint64_t last_retire;               //retire cycle of the previous instr.
+}window_model;
+
+int main (int argc, char* argv[])
+{
+    std::vector<unsigned long> windows;
+    Op_Table ops;
+    const char *csv_file = NULL;
+    int argi = 1;
+
+    while (argi < argc && strncmp(argv[argi], "--", 2) == 0)
+    {
+        if (strncmp(argv[argi], "--windows=", 10) == 0)
+        {
+            if (!parse_param_list(argv[argi] + 10, windows))
+            {
+                printf("Error: Malformed window list %s\n", argv[argi] + 10);
+                exit(EXIT_FAILURE);
+            }
+        }
+        else if (strncmp(argv[argi], "--fu-config=", 12) == 0)
+        {
+            if (!ops.load(argv[argi] + 12))
+                exit(EXIT_FAILURE);
+        }
+        else if (strncmp(argv[argi], "--csv=", 6) == 0)
+            csv_file = argv[argi] + 6;
+        else
+        {
+            printf("Error: Unknown option %s\n", argv[argi]);
+            exit(EXIT_FAILURE);
+        }
+        argi++;
+    }
+    if (argc - argi != 1)
+    {
+        printf("Error: Wrong number of inputs:%d\n", argc-argi);
+        printf("Usage: %s [--windows=LIST] [--fu-config=FILE] [--csv=FILE] <trace>\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    const char *trace_file = argv[argi];
+    if (windows.empty())
+        parse_param_list("4:4096:x2", windows);
+
+    //the bounded windows, then the unbounded one
+    std::vector<window_model> models(windows.size() + 1);
+    for (size_t w = 0; w < models.size(); w++)
+    {
+        window_model &m = models[w];
+        m.size = (w < windows.size()) ? windows[w] : 0;
+        m.retired.assign(m.size, 0);
+        m.next = 0;
+        memset(m.ready, 0, sizeof(m.ready));
+        m.last_retire = 0;
+    }
+
+    Trace_Reader *trace = open_trace(trace_file);
+    if (trace == NULL)
+    {
+        printf("Error: Unable to open file %s\n", trace_file);
+        exit(EXIT_FAILURE);
+    }
+    uint64_t num_instr = 0;
+    while (trace->cur != trace->end || trace->refill())
+    {
+        for (; trace->cur != trace->end; trace->cur++, num_instr++)
+        {
+            const trace_record &rec = *trace->cur;
+            if (rec.dst >= NUM_ARCH_REGS || rec.src1 >= NUM_ARCH_REGS || rec.src2 >= NUM_ARCH_REGS)
+            {
+                printf("Error: Instruction %llu names a register beyond %d\n", (unsigned long long)num_instr,
+                        NUM_ARCH_REGS - 1);
+                exit(EXIT_FAILURE);
+            }
+            uint64_t latency = ops.get_latency(rec.op_type);
+            for (size_t w = 0; w < models.size(); w++)
+            {
+                window_model &m = models[w];
+                //enters when the instr. size back retires, starts once its sources are produced
+                uint64_t start = (m.size != 0 && num_instr >= m.size) ? m.retired[m.next] : 0;
+                if (rec.src1 >= 0 && m.ready[rec.src1] > start)
+                    start = m.ready[rec.src1];
+                if (rec.src2 >= 0 && m.ready[rec.src2] > start)
+                    start = m.ready[rec.src2];
+                uint64_t done = start + latency;
+                if (rec.dst >= 0)
+                    m.ready[rec.dst] = done;
+                if (done > m.last_retire)
+                    m.last_retire = done;
+                if (m.size != 0)
+                {
+                    m.retired[m.next] = m.last_retire;
+                    m.next = (m.next + 1 == m.size) ? 0 : m.next + 1;
+                }
+            }
+        }
+    }
+    delete trace;
+
+    FILE *csv = NULL;
+    if (csv_file != NULL && (csv = fopen(csv_file, "w")) == NULL)
+    {
+        printf("Error: Unable to open file %s\n", csv_file);
+        exit(EXIT_FAILURE);
+    }
+    if (csv != NULL)
+        fprintf(csv, "window,cycles,ipc\n");
+
+    const window_model &unbounded = models.back();
+    printf("# === Dataflow Limit ============\n");
+    printf("# %s\n", trace_file);
+    printf("# Dynamic Instruction Count    = %llu\n", (unsigned long long)num_instr);
+    printf("# Critical Path (cycles)       = %llu\n", (unsigned long long)unbounded.last_retire);
+    printf("# Dataflow IPC                 = %.2f\n",
+            unbounded.last_retire != 0 ? double(num_instr) / unbounded.last_retire : 0.0);
+    printf("# === ILP vs. Window ============\n");
+    printf("# %10s %14s %10s\n", "window", "cycles", "IPC");
+    for (size_t w = 0; w < models.size(); w++)
+    {
+        const window_model &m = models[w];
+        double ipc = m.last_retire != 0 ? double(num_instr) / m.last_retire : 0.0;
+        if (m.size != 0)
+            printf("  %10lu %14llu %10.2f\n", m.size, (unsigned long long)m.last_retire, ipc);
+        else
+            printf("  %10s %14llu %10.2f\n", "unbounded", (unsigned long long)m.last_retire, ipc);
+        if (csv != NULL)
+            fprintf(csv, "%lu,%llu,%.6f\n", m.size, (unsigned long long)m.last_retire, ipc);
+    }
+    if (csv != NULL && fclose(csv) != 0)
+    {
+        printf("Error: Unable to write file %s\n", csv_file);
+        exit(EXIT_FAILURE);
+    }
+
+    return 0;
+}
@@ -0,0 +1,529 @@
+#ifndef TRACE_IO_H
+#define TRACE_IO_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cctype>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <zlib.h>
+#include <lzma.h>
+
+//Trace Formats---------------------------------------------------------------------------------------------------------
+//
+//text:   one instruction per line, "<pc hex> <op_type> <dst> <src1> <src2>"
+//binary: trace_header followed by num_records fixed-width trace_records,
+//        produced from a text trace by trace_conv
+//either may be gzip or xz compressed
+//
+//the simulator detects binary and compressed traces by their magic numbers, so any
+//kind of file is accepted wherever a trace file name is expected
+
+#define TRACE_MAGIC         "SIMTRACE"
+#define TRACE_MAGIC_LEN     8
+#define TRACE_VERSION       1
+
+static const unsigned char GZIP_MAGIC[2] = {0x1f, 0x8b};
+static const unsigned char XZ_MAGIC[6] = {0xfd, '7', 'z', 'X', 'Z', 0x00};
+
+typedef struct trace_header{
+    char magic[TRACE_MAGIC_LEN];
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t num_records;
+    uint64_t reserved;
+}trace_header;
+
+//one decoded instruction, as stored in a binary trace
+typedef struct trace_record{
+    uint64_t pc;
+    int16_t op_type, dst, src1, src2;
+}trace_record;
+
+//a binary trace header this build can read; its num_records is checked against the data separately
+inline bool valid_trace_header(const trace_header *hdr){
+    return memcmp(hdr->magic, TRACE_MAGIC, TRACE_MAGIC_LEN) == 0 && hdr->version == TRACE_VERSION
+            && hdr->record_size == sizeof(trace_record);
+}
+
+
+//Trace Readers---------------------------------------------------------------------------------------------------------
+
+//Fetch consumes records from [cur, end); refill() makes more records available
+//and returns false once the trace is exhausted
+class Trace_Reader{
+public:
+    const trace_record *cur, *end;
+    Trace_Reader() : cur(NULL), end(NULL){}
+    virtual ~Trace_Reader(){}
+    virtual bool refill() = 0;
+    inline const trace_record *next(){
+        if(cur == end && !refill()){
+            return NULL;
+        }
+        return cur++;
+    }
+};
+
+//text trace, parsed a block of records at a time
+class Text_Trace_Reader : public Trace_Reader{
+public:
+    static const int BLOCK = 4096;
+    FILE *FP;
+    trace_record block[BLOCK];
+    Text_Trace_Reader(FILE *fp) : FP(fp){}
+    ~Text_Trace_Reader(){ fclose(FP); }
+    bool refill(){
+        int n = 0;
+        unsigned long long pc;
+        int op_type, dest, src1, src2;
+        while(n < BLOCK && fscanf(FP, "%llx %d %d %d %d", &pc, &op_type, &dest, &src1, &src2) == 5){
+            block[n].pc = pc;
+            block[n].op_type = op_type;
+            block[n].dst = dest;
+            block[n].src1 = src1;
+            block[n].src2 = src2;
+            n++;
+        }
+        cur = block;
+        end = block + n;
+        return n != 0;
+    }
+};
+
+//binary trace, mapped read-only; records are used in place
+//handed out a window at a time, and the pages of windows already consumed are dropped, so
+//resident memory stays at about one window however long the trace is
+class Binary_Trace_Reader : public Trace_Reader{
+public:
+    static const size_t WINDOW = 1 << 16;   //records per refill, 1MB
+    void *map;
+    size_t map_len;
+    const trace_record *next_rec, *last;    //first record not handed out yet, end of trace
+    char *released;                         //pages before this have been dropped
+    Binary_Trace_Reader(void *m, size_t len) : map(m), map_len(len), released((char *)m){
+        const trace_header *hdr = (const trace_header *)map;
+        next_rec = (const trace_record *)(hdr + 1);
+        last = next_rec + hdr->num_records;
+        madvise(map, map_len, MADV_SEQUENTIAL);
+        cur = end = next_rec;
+    }
+    ~Binary_Trace_Reader(){ munmap(map, map_len); }
+    bool refill(){
+        static const uintptr_t page = sysconf(_SC_PAGESIZE);
+        char *done = (char *)((uintptr_t)end & ~(page - 1));
+        if(done > released){
+            madvise(released, done - released, MADV_DONTNEED);
+            released = done;
+        }
+        if(next_rec == last){
+            return false;
+        }
+        cur = next_rec;
+        end = (last - next_rec > (ptrdiff_t)WINDOW) ? next_rec + WINDOW : last;
+        next_rec = end;
+        return true;
+    }
+};
+
+//in-memory records, e.g. a shared Trace_Image
+class Memory_Trace_Reader : public Trace_Reader{
+public:
+    Memory_Trace_Reader(const trace_record *records, size_t num_records){
+        cur = records;
+        end = records + num_records;
+    }
+    bool refill(){ return false; }
+};
+
+//Compressed Traces-----------------------------------------------------------------------------------------------------
+//
+//gzip and xz traces (text or binary inside) are decompressed and parsed on a background thread
+//into a bounded single-producer/single-consumer ring of record blocks that Fetch drains, so
+//parsing overlaps simulation and memory use is fixed by the ring size, not the trace length
+
+//decompressed byte stream
+class Byte_Stream{
+public:
+    virtual ~Byte_Stream(){}
+    //read up to n bytes, returns 0 at end of stream and -1 on error
+    virtual long read(char *buf, size_t n) = 0;
+};
+
+class Gzip_Stream : public Byte_Stream{
+public:
+    gzFile gz;
+    Gzip_Stream(gzFile g) : gz(g){ gzbuffer(gz, 1 << 18); }
+    ~Gzip_Stream(){ gzclose(gz); }
+    long read(char *buf, size_t n){
+        int got = gzread(gz, buf, n);
+        int err = Z_OK;
+        //a truncated stream reads as end of file with an error set
+        if(got == 0){
+            gzerror(gz, &err);
+        }
+        return (err == Z_OK || err == Z_STREAM_END) ? got : -1;
+    }
+};
+
+class Xz_Stream : public Byte_Stream{
+public:
+    FILE *FP;
+    lzma_stream strm;
+    uint8_t in[1 << 16];
+    bool in_eof;
+    Xz_Stream(FILE *fp) : FP(fp), in_eof(false){
+        lzma_stream init = LZMA_STREAM_INIT;
+        strm = init;
+    }
+    ~Xz_Stream(){
+        lzma_end(&strm);
+        fclose(FP);
+    }
+    bool open(){
+        return lzma_stream_decoder(&strm, UINT64_MAX, LZMA_CONCATENATED) == LZMA_OK;
+    }
+    long read(char *buf, size_t n){
+        strm.next_out = (uint8_t *)buf;
+        strm.avail_out = n;
+        while(strm.avail_out != 0){
+            if(strm.avail_in == 0 && !in_eof){
+                strm.next_in = in;
+                strm.avail_in = fread(in, 1, sizeof(in), FP);
+                if(strm.avail_in == 0){
+                    if(ferror(FP)){
+                        return -1;
+                    }
+                    in_eof = true;
+                }
+            }
+            lzma_ret ret = lzma_code(&strm, in_eof ? LZMA_FINISH : LZMA_RUN);
+            if(ret == LZMA_STREAM_END){
+                break;
+            }
+            if(ret != LZMA_OK){
+                return -1;
+            }
+        }
+        return n - strm.avail_out;
+    }
+};
+
+class Stream_Trace_Reader : public Trace_Reader{
+public:
+    static const unsigned long BLOCKS = 16;
+    static const unsigned long BLOCK = 4096;
+    static const size_t BUF_SIZE = 1 << 18;
+    Byte_Stream *in;
+    std::vector<trace_record> ring;         //BLOCKS blocks of BLOCK records
+    unsigned long fill[BLOCKS];             //records in each block
+    std::atomic<unsigned long> head;        //blocks published by the producer
+    std::atomic<unsigned long> tail;        //blocks released by the consumer
+    std::atomic<bool> done, stop;
+    const char *error;                      //written by the producer before done, NULL if the trace was read whole
+    bool holding;                           //consumer is reading block tail
+    std::thread producer;
+
+    Stream_Trace_Reader(Byte_Stream *s) : in(s), ring(BLOCKS * BLOCK), head(0), tail(0), done(false), stop(false),
+            error(NULL), holding(false){
+        producer = std::thread(&Stream_Trace_Reader::produce, this);
+    }
+    ~Stream_Trace_Reader(){
+        stop.store(true);
+        producer.join();
+        delete in;
+    }
+
+    bool refill(){
+        if(holding){
+            tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+            holding = false;
+        }
+        unsigned long t = tail.load(std::memory_order_relaxed);
+        while(head.load(std::memory_order_acquire) == t){
+            if(done.load(std::memory_order_acquire) && head.load(std::memory_order_acquire) == t){
+                if(error != NULL){
+                    printf("Error: %s\n", error);
+                    exit(EXIT_FAILURE);
+                }
+                return false;
+            }
+            std::this_thread::yield();
+        }
+        cur = &ring[(t % BLOCKS) * BLOCK];
+        end = cur + fill[t % BLOCKS];
+        holding = true;
+        return true;
+    }
+
+    //producer side-------------------------------------------------------------
+    //block being filled, NULL until a ring slot is free
+    trace_record *claim(){
+        unsigned long h = head.load(std::memory_order_relaxed);
+        while(h - tail.load(std::memory_order_acquire) >= BLOCKS){
+            if(stop.load(std::memory_order_relaxed)){
+                return NULL;
+            }
+            std::this_thread::yield();
+        }
+        return &ring[(h % BLOCKS) * BLOCK];
+    }
+    void publish(unsigned long n){
+        unsigned long h = head.load(std::memory_order_relaxed);
+        fill[h % BLOCKS] = n;
+        head.store(h + 1, std::memory_order_release);
+    }
+
+    static inline bool parse_hex(const char *&p, const char *e, uint64_t &v){
+        while(p < e && isspace((unsigned char)*p)){ p++; }
+        if(e - p > 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X')){ p += 2; }
+        const char *start = p;
+        v = 0;
+        for(; p < e; p++){
+            unsigned d;
+            if(*p >= '0' && *p <= '9'){ d = *p - '0'; }
+            else if((*p | 0x20) >= 'a' && (*p | 0x20) <= 'f'){ d = (*p | 0x20) - 'a' + 10; }
+            else{ break; }
+            v = (v << 4) | d;
+        }
+        return p != start;
+    }
+    static inline bool parse_int(const char *&p, const char *e, int16_t &v){
+        while(p < e && isspace((unsigned char)*p)){ p++; }
+        bool neg = (p < e && *p == '-');
+        if(neg || (p < e && *p == '+')){ p++; }
+        const char *start = p;
+        int x = 0;
+        for(; p < e && *p >= '0' && *p <= '9'; p++){
+            x = x * 10 + (*p - '0');
+        }
+        v = neg ? -x : x;
+        return p != start;
+    }
+
+    void produce(){
+        std::vector<char> buf(BUF_SIZE);
+        size_t len = 0;
+        bool eof = false, binary = false, first = true;
+        uint64_t left = 0;                  //records a binary trace's header still promises
+        trace_record *block = NULL;
+        unsigned long n = 0;
+        while(!eof && !stop.load(std::memory_order_relaxed)){
+            long got = in->read(&buf[len], BUF_SIZE - len);
+            if(got < 0){
+                error = "Unable to decompress trace";
+                break;
+            }
+            eof = (got == 0);
+            len += got;
+            const char *p = &buf[0], *e = p + len;
+            if(first && (len >= sizeof(trace_header) || eof)){
+                first = false;
+                if(len >= sizeof(trace_header) && memcmp(p, TRACE_MAGIC, TRACE_MAGIC_LEN) == 0){
+                    //checked as a mapped binary trace is, see valid_binary_trace
+                    trace_header hdr;
+                    memcpy(&hdr, p, sizeof(hdr));
+                    if(!valid_trace_header(&hdr)){
+                        error = "Binary trace version or record size doesn't match this build";
+                        break;
+                    }
+                    binary = true;
+                    left = hdr.num_records;
+                    p += sizeof(trace_header);
+                }
+            }
+            else if(first){
+                continue;
+            }
+            //only whole tokens/records are consumed, the rest carries over to the next read
+            const char *stop_at = e;
+            if(!binary && !eof){
+                while(stop_at > p && !isspace((unsigned char)stop_at[-1])){ stop_at--; }
+            }
+            while(true){
+                trace_record rec;
+                if(binary){
+                    if(left == 0 || e - p < (long)sizeof(trace_record)){ break; }
+                    memcpy(&rec, p, sizeof(rec));
+                    p += sizeof(rec);
+                    left--;
+                }
+                else{
+                    const char *q = p;
+                    while(q < stop_at && isspace((unsigned char)*q)){ q++; }
+                    if(q == stop_at){ p = q; break; }
+                    //a record cut off by the end of this read is finished by the next one,
+                    //a malformed record ends the trace like a short fscanf() match did
+                    if(!parse_hex(p, stop_at, rec.pc) || !parse_int(p, stop_at, rec.op_type) || !parse_int(p, stop_at, rec.dst)
+                            || !parse_int(p, stop_at, rec.src1) || !parse_int(p, stop_at, rec.src2)){
+                        p = q;
+                        break;
+                    }
+                }
+                if(block == NULL && (block = claim()) == NULL){
+                    break;
+                }
+                block[n++] = rec;
+                if(n == BLOCK){
+                    publish(n);
+                    block = NULL;
+                    n = 0;
+                }
+            }
+            len = e - p;
+            memmove(&buf[0], p, len);
+            //a record that can't complete even with a full buffer is malformed
+            //and anything after a binary trace's last record is ignored, as when mapped
+            if(len == BUF_SIZE || (binary && left == 0)){
+                eof = true;
+            }
+        }
+        if(binary && left != 0 && error == NULL && !stop.load(std::memory_order_relaxed)){
+            error = "Binary trace has fewer records than its header says";
+        }
+        if(n != 0){
+            publish(n);
+        }
+        done.store(true, std::memory_order_release);
+    }
+};
+
+//at most limit records of another reader, e.g. one sampling unit of a longer trace
+class Window_Trace_Reader : public Trace_Reader{
+public:
+    Trace_Reader &src;
+    uint64_t left;
+    Window_Trace_Reader(Trace_Reader &s, uint64_t limit) : src(s), left(limit){}
+    bool refill(){
+        if(left == 0 || (src.cur == src.end && !src.refill())){
+            return false;
+        }
+        uint64_t n = src.end - src.cur;
+        if(n > left){
+            n = left;
+        }
+        cur = src.cur;
+        end = cur + n;
+        src.cur += n;
+        left -= n;
+        return true;
+    }
+};
+
+//advance trace past up to n records without decoding them individually, returns the number skipped
+inline uint64_t skip_trace(Trace_Reader &trace, uint64_t n){
+    uint64_t skipped = 0;
+    while(skipped < n && (trace.cur != trace.end || trace.refill())){
+        uint64_t avail = trace.end - trace.cur;
+        if(avail > n - skipped){
+            avail = n - skipped;
+        }
+        trace.cur += avail;
+        skipped += avail;
+    }
+    return skipped;
+}
+
+//whole trace decoded once into read-only memory, so many runs can share it
+//a binary trace is used straight from its mapping, a text trace is parsed into decoded
+class Trace_Image{
+public:
+    const trace_record *records;
+    size_t num_records;
+    Trace_Reader *mapped;   //keeps a mapped binary trace alive
+    std::vector<trace_record> decoded;
+    Trace_Image() : records(NULL), num_records(0), mapped(NULL){}
+    ~Trace_Image(){ delete mapped; }
+};
+
+//check a mapped file for a valid binary trace header
+inline bool valid_binary_trace(const void *map, size_t len){
+    const trace_header *hdr = (const trace_header *)map;
+    if(len < sizeof(trace_header) || !valid_trace_header(hdr)){
+        return false;
+    }
+    return hdr->num_records <= (len - sizeof(trace_header)) / sizeof(trace_record);
+}
+
+//open trace_file in either format, returns NULL if it can't be read
+inline Trace_Reader *open_trace(const char *trace_file){
+    int fd = open(trace_file, O_RDONLY);
+    if(fd < 0){
+        return NULL;
+    }
+    char magic[TRACE_MAGIC_LEN];
+    struct stat st;
+    ssize_t magic_len = pread(fd, magic, TRACE_MAGIC_LEN, 0);
+    if(magic_len >= (ssize_t)sizeof(GZIP_MAGIC) && memcmp(magic, GZIP_MAGIC, sizeof(GZIP_MAGIC)) == 0){
+        gzFile gz = gzdopen(fd, "rb");
+        if(gz == NULL){
+            close(fd);
+            return NULL;
+        }
+        return new Stream_Trace_Reader(new Gzip_Stream(gz));
+    }
+    if(magic_len >= (ssize_t)sizeof(XZ_MAGIC) && memcmp(magic, XZ_MAGIC, sizeof(XZ_MAGIC)) == 0){
+        FILE *FP = fdopen(fd, "rb");
+        if(FP == NULL){
+            close(fd);
+            return NULL;
+        }
+        Xz_Stream *xz = new Xz_Stream(FP);
+        if(!xz->open()){
+            delete xz;
+            return NULL;
+        }
+        return new Stream_Trace_Reader(xz);
+    }
+    if(magic_len == TRACE_MAGIC_LEN && memcmp(magic, TRACE_MAGIC, TRACE_MAGIC_LEN) == 0
+            && fstat(fd, &st) == 0){
+        void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if(map == MAP_FAILED){
+            return NULL;
+        }
+        if(!valid_binary_trace(map, st.st_size)){
+            munmap(map, st.st_size);
+            return NULL;
+        }
+        return new Binary_Trace_Reader(map, st.st_size);
+    }
+    FILE *FP = fdopen(fd, "r");
+    if(FP == NULL){
+        close(fd);
+        return NULL;
+    }
+    return new Text_Trace_Reader(FP);
+}
+
+//load trace_file into img, returns false if it can't be read
+inline bool load_trace_image(const char *trace_file, Trace_Image &img){
+    Trace_Reader *trace = open_trace(trace_file);
+    if(trace == NULL){
+        return false;
+    }
+    //a binary trace is shared straight from its mapping, not through the reader's window
+    Binary_Trace_Reader *binary = dynamic_cast<Binary_Trace_Reader *>(trace);
+    if(binary != NULL){
+        img.records = binary->next_rec;
+        img.num_records = binary->last - binary->next_rec;
+        img.mapped = trace;
+        return true;
+    }
+    do {
+        img.decoded.insert(img.decoded.end(), trace->cur, trace->end);
+    } while(trace->refill());
+    delete trace;
+    img.records = img.decoded.data();
+    img.num_records = img.decoded.size();
+    return true;
+}
+
+#endif